@@ -0,0 +1,271 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include "asyncpricer.hpp"
+#include <ql/exercise.hpp>
+#include <ql/quotes/simplequote.hpp>
+#include <ql/termstructures/yield/flatforward.hpp>
+#include <ql/termstructures/volatility/equityfx/blackconstantvol.hpp>
+#include <ql/time/calendars/nullcalendar.hpp>
+#include <ql/time/daycounters/actual365fixed.hpp>
+#include <boost/bind.hpp>
+#include <cmath>
+
+namespace QuantLib {
+
+    VanillaPricingRequest VanillaPricingRequest::snapshot(
+             const VanillaOption& option,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                                                                process) {
+        // price() rebuilds a plain payoff, as the engines require
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                                                        option.payoff());
+        QL_REQUIRE(payoff, "non-plain payoff given");
+        boost::shared_ptr<Exercise> exercise = option.exercise();
+        QL_REQUIRE(exercise->type() != Exercise::Bermudan,
+                   "Bermudan exercise not supported");
+
+        VanillaPricingRequest request;
+        request.type = payoff->optionType();
+        request.strike = payoff->strike();
+        request.expiry = exercise->lastDate();
+        request.american = exercise->type() == Exercise::American;
+        request.earliestExercise = exercise->date(0);
+        request.payoffAtExpiry = false;
+        if (request.american) {
+            boost::shared_ptr<AmericanExercise> american =
+                boost::dynamic_pointer_cast<AmericanExercise>(exercise);
+            QL_REQUIRE(american, "wrong exercise given");
+            request.payoffAtExpiry = american->payoffAtExpiry();
+        }
+        request.spot = process->x0();
+        // rebuilt on the same day counter by price(), so that the
+        // discount factors at expiry are reproduced
+        DayCounter dayCounter = Actual365Fixed();
+        request.riskFreeRate = process->riskFreeRate()->zeroRate(
+                     request.expiry, dayCounter, Continuous, NoFrequency);
+        request.dividendYield = process->dividendYield()->zeroRate(
+                     request.expiry, dayCounter, Continuous, NoFrequency);
+        request.valuationDate = process->riskFreeRate()->referenceDate();
+        // the variance is read at the spot, as BinomialVanillaEngine_2
+        // does, and spread over the same day counter, so that the
+        // total variance to expiry is reproduced
+        Real variance = process->blackVolatility()->blackVariance(
+                                             request.expiry, request.spot);
+        Time t = dayCounter.yearFraction(request.valuationDate,
+                                         request.expiry);
+        request.volatility = t > 0.0 ?
+            std::sqrt(variance/t) :
+            process->blackVolatility()->blackVol(request.expiry,
+                                                 request.spot);
+        return request;
+    }
+
+    bool VanillaPricingRequest::operator<(
+                                   const VanillaPricingRequest& o) const {
+        if (type != o.type)
+            return type < o.type;
+        if (strike != o.strike)
+            return strike < o.strike;
+        if (expiry != o.expiry)
+            return expiry < o.expiry;
+        if (american != o.american)
+            return american < o.american;
+        if (earliestExercise != o.earliestExercise)
+            return earliestExercise < o.earliestExercise;
+        if (payoffAtExpiry != o.payoffAtExpiry)
+            return payoffAtExpiry < o.payoffAtExpiry;
+        if (spot != o.spot)
+            return spot < o.spot;
+        if (riskFreeRate != o.riskFreeRate)
+            return riskFreeRate < o.riskFreeRate;
+        if (dividendYield != o.dividendYield)
+            return dividendYield < o.dividendYield;
+        if (volatility != o.volatility)
+            return volatility < o.volatility;
+        return valuationDate < o.valuationDate;
+    }
+
+
+    AsyncVanillaPricer::AsyncVanillaPricer(const EngineFactory& factory,
+                                           Size threads)
+    : factory_(factory), stopping_(false), requests_(0), computations_(0) {
+        if (threads == 0)
+            threads = std::max<Size>(boost::thread::hardware_concurrency(),
+                                     1);
+        for (Size i=0; i<threads; ++i)
+            workers_.create_thread(
+                             boost::bind(&AsyncVanillaPricer::work, this));
+    }
+
+    AsyncVanillaPricer::~AsyncVanillaPricer() {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        workers_.join_all();
+    }
+
+    boost::shared_future<VanillaPricingResult> AsyncVanillaPricer::submit(
+                                   const VanillaPricingRequest& request) {
+        return enqueue(request, 0)->future;
+    }
+
+    void AsyncVanillaPricer::submit(const VanillaPricingRequest& request,
+                                    const Callback& callback) {
+        enqueue(request, &callback);
+    }
+
+    boost::shared_future<VanillaPricingResult> AsyncVanillaPricer::submit(
+             const VanillaOption& option,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                                                                process) {
+        return submit(VanillaPricingRequest::snapshot(option, process));
+    }
+
+    Size AsyncVanillaPricer::requests() const {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        return requests_;
+    }
+
+    Size AsyncVanillaPricer::computations() const {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        return computations_;
+    }
+
+    boost::shared_ptr<AsyncVanillaPricer::InFlight>
+    AsyncVanillaPricer::enqueue(const VanillaPricingRequest& request,
+                                const Callback* callback) {
+        boost::shared_ptr<InFlight> pending;
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            QL_REQUIRE(!stopping_, "pricer is shutting down");
+            ++requests_;
+            InFlightMap::iterator i = inFlight_.find(request);
+            if (i == inFlight_.end()) {
+                pending = boost::shared_ptr<InFlight>(new InFlight);
+                pending->future = boost::shared_future<VanillaPricingResult>(
+                                               pending->promise.get_future());
+                i = inFlight_.insert(std::make_pair(request, pending)).first;
+                queue_.push_back(i);
+                ++computations_;
+            } else {
+                pending = i->second;
+            }
+            if (callback)
+                pending->callbacks.push_back(*callback);
+        }
+        ready_.notify_one();
+        return pending;
+    }
+
+    void AsyncVanillaPricer::work() {
+        for (;;) {
+            InFlightMap::iterator i;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex_);
+                while (queue_.empty() && !stopping_)
+                    ready_.wait(lock);
+                if (queue_.empty())
+                    return;
+                i = queue_.front();
+                queue_.pop_front();
+            }
+
+            // the key stays valid, as only this thread erases it
+            VanillaPricingResult result = price(i->first);
+
+            boost::shared_ptr<InFlight> done;
+            {
+                // later equal requests start a new computation
+                boost::lock_guard<boost::mutex> lock(mutex_);
+                done = i->second;
+                inFlight_.erase(i);
+            }
+            done->promise.set_value(result);
+            for (Size k=0; k<done->callbacks.size(); ++k) {
+                try {
+                    done->callbacks[k](result);
+                } catch (...) {}
+            }
+        }
+    }
+
+    VanillaPricingResult AsyncVanillaPricer::price(
+                             const VanillaPricingRequest& request) const {
+        VanillaPricingResult result;
+        result.npv = result.delta = result.gamma = Null<Real>();
+        result.theta = result.vega = result.errorEstimate = Null<Real>();
+        try {
+            const Date& today = request.valuationDate;
+            DayCounter dayCounter = Actual365Fixed();
+            Handle<Quote> spot(
+                boost::shared_ptr<Quote>(new SimpleQuote(request.spot)));
+            Handle<YieldTermStructure> riskFree(
+                boost::shared_ptr<YieldTermStructure>(
+                    new FlatForward(today, request.riskFreeRate,
+                                    dayCounter)));
+            Handle<YieldTermStructure> dividends(
+                boost::shared_ptr<YieldTermStructure>(
+                    new FlatForward(today, request.dividendYield,
+                                    dayCounter)));
+            Handle<BlackVolTermStructure> volatility(
+                boost::shared_ptr<BlackVolTermStructure>(
+                    new BlackConstantVol(today, NullCalendar(),
+                                         request.volatility, dayCounter)));
+            boost::shared_ptr<GeneralizedBlackScholesProcess> process(
+                new BlackScholesMertonProcess(spot, dividends,
+                                              riskFree, volatility));
+
+            boost::shared_ptr<PricingEngine> engine = factory_(process);
+            engine->reset();
+            VanillaOption::arguments* arguments =
+                dynamic_cast<VanillaOption::arguments*>(
+                                                  engine->getArguments());
+            QL_REQUIRE(arguments, "wrong argument type");
+            arguments->payoff = boost::shared_ptr<Payoff>(
+                      new PlainVanillaPayoff(request.type, request.strike));
+            if (request.american)
+                arguments->exercise = boost::shared_ptr<Exercise>(
+                    new AmericanExercise(request.earliestExercise,
+                                         request.expiry,
+                                         request.payoffAtExpiry));
+            else
+                arguments->exercise = boost::shared_ptr<Exercise>(
+                                     new EuropeanExercise(request.expiry));
+            arguments->validate();
+            engine->calculate();
+
+            const VanillaOption::results* results =
+                dynamic_cast<const VanillaOption::results*>(
+                                                    engine->getResults());
+            QL_REQUIRE(results, "wrong result type");
+            result.npv = results->value;
+            result.delta = results->delta;
+            result.gamma = results->gamma;
+            result.theta = results->theta;
+            result.vega = results->vega;
+            result.errorEstimate = results->errorEstimate;
+        } catch (std::exception& e) {
+            result.error = e.what();
+        }
+        return result;
+    }
+
+}
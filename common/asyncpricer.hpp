@@ -0,0 +1,160 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file asyncpricer.hpp
+    \brief Asynchronous vanilla pricing with request coalescing
+
+    The classes are implemented in asyncpricer.cpp, which must be
+    compiled into the program.
+*/
+
+#ifndef imt_async_pricer_hpp
+#define imt_async_pricer_hpp
+
+#include <ql/instruments/vanillaoption.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/future.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Snapshot of a vanilla option and of its market
+    /*! The market is reduced to flat curves and a constant volatility
+        reproducing the discount factors and the total variance at the
+        expiry of the option, with the variance read at the spot as in
+        BinomialVanillaEngine_2; engines reading the volatility
+        elsewhere, e.g., at the strike, give a result different from
+        that of the instrument on a smile. Two requests are the same
+        computation if and only if they compare equal; values are
+        compared exactly.
+    */
+    struct VanillaPricingRequest {
+        Option::Type type;
+        Real strike;
+        Date expiry;
+        bool american;
+        //! first exercise date; the expiry for a European option
+        Date earliestExercise;
+        //! for an American option, whether its payoff is at expiry
+        bool payoffAtExpiry;
+        Real spot;
+        Rate riskFreeRate, dividendYield;
+        Volatility volatility;
+        Date valuationDate;
+
+        //! reads the option and the current state of the market
+        /*! This must be called from the thread that owns the
+            instrument and the market objects.
+        */
+        static VanillaPricingRequest snapshot(
+             const VanillaOption& option,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>&);
+        bool operator<(const VanillaPricingRequest&) const;
+    };
+
+    //! Results of a vanilla pricing request
+    /*! Results not provided by the engine are null; if the option
+        couldn't be priced, error holds the reason.
+    */
+    struct VanillaPricingResult {
+        Real npv, delta, gamma, theta, vega, errorEstimate;
+        std::string error;
+    };
+
+
+    //! Thread pool pricing vanilla options asynchronously
+    /*! Requests are queued and priced in order of submission by the
+        worker threads, each on market objects built from the
+        snapshot alone, so that workers share no observables; the
+        engine is driven through its arguments and results rather than
+        through an instrument.
+
+        A request equal to one still queued or being priced is not
+        computed again: the caller gets the future of the request in
+        flight, or its callback is added to those of the request.
+        Results are not kept once delivered.
+
+        Callbacks are run on the worker thread after the future is
+        ready; they must not block, and exceptions thrown by them are
+        discarded. Requests still pending when the pricer is destroyed
+        are priced before the destructor returns.
+    */
+    class AsyncVanillaPricer : private boost::noncopyable {
+      public:
+        typedef boost::function<boost::shared_ptr<PricingEngine>(
+                const boost::shared_ptr<GeneralizedBlackScholesProcess>&)>
+                                                            EngineFactory;
+        typedef boost::function<void(const VanillaPricingResult&)>
+                                                                 Callback;
+        /*! \param factory  called by the workers to build a new engine
+                            for each computation
+            \param threads  worker threads; 0 for one per core
+        */
+        explicit AsyncVanillaPricer(const EngineFactory& factory,
+                                    Size threads = 0);
+        ~AsyncVanillaPricer();
+
+        boost::shared_future<VanillaPricingResult> submit(
+                                         const VanillaPricingRequest&);
+        void submit(const VanillaPricingRequest&, const Callback&);
+        //! snapshots the option and its market and submits them
+        boost::shared_future<VanillaPricingResult> submit(
+             const VanillaOption& option,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>&);
+
+        //! \name Statistics
+        //@{
+        //! requests submitted so far
+        Size requests() const;
+        //! computations started or queued so far
+        Size computations() const;
+        //@}
+      private:
+        struct InFlight {
+            boost::promise<VanillaPricingResult> promise;
+            boost::shared_future<VanillaPricingResult> future;
+            std::vector<Callback> callbacks;
+        };
+        typedef std::map<VanillaPricingRequest,
+                         boost::shared_ptr<InFlight> > InFlightMap;
+        boost::shared_ptr<InFlight> enqueue(const VanillaPricingRequest&,
+                                            const Callback*);
+        void work();
+        VanillaPricingResult price(const VanillaPricingRequest&) const;
+
+        EngineFactory factory_;
+        mutable boost::mutex mutex_;
+        boost::condition_variable ready_;
+        std::deque<InFlightMap::iterator> queue_;
+        InFlightMap inFlight_;
+        bool stopping_;
+        Size requests_, computations_;
+        boost::thread_group workers_;
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,163 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include "columnarfile.hpp"
+#include <ql/errors.hpp>
+#include <cstring>
+#include <fstream>
+
+namespace QuantLib {
+
+    namespace {
+
+        const boost::uint32_t byteOrderMark = 0x01020304;
+
+        Size aligned(Size offset) {
+            return (offset + 7) & ~Size(7);
+        }
+
+    }
+
+    const boost::uint32_t ColumnarFile::version;
+    const Size ColumnarFile::maxColumns;
+
+    const ColumnarFile::Column BookFile::columns_[] = {
+        { sizeof(Real), false },
+        { sizeof(boost::int32_t), false },
+        { sizeof(boost::int8_t), false },
+        { sizeof(boost::int8_t), false },
+        { sizeof(boost::uint32_t), false },
+        { sizeof(Real), true },
+        { sizeof(Rate), true },
+        { sizeof(Rate), true },
+        { sizeof(Volatility), true }
+    };
+
+    const ColumnarFile::Column ResultsFile::columns_[] = {
+        { sizeof(Real), false },
+        { sizeof(Real), false },
+        { sizeof(Real), false },
+        { sizeof(Real), false },
+        { sizeof(Real), false },
+        { sizeof(boost::uint8_t), false }
+    };
+
+    ColumnarFile::ColumnarFile(const std::string& path, const char* magic,
+                               const Column* columns, Size columnCount,
+                               bool writable) {
+        map(path, writable);
+        QL_REQUIRE(region_.get_size() >= sizeof(Header),
+                   path << " is too short for a columnar file");
+        QL_REQUIRE(std::memcmp(header_->magic, magic, 4) == 0,
+                   path << " is not a " << std::string(magic, 4) << " file");
+        QL_REQUIRE(header_->byteOrder == byteOrderMark,
+                   path << " was written with a different byte order");
+        QL_REQUIRE(header_->version == version,
+                   path << " has version " << header_->version
+                   << "; version " << version << " expected");
+        QL_REQUIRE(header_->columns == columnCount,
+                   path << " has " << header_->columns << " columns; "
+                   << columnCount << " expected");
+        for (Size i=0; i<columnCount; ++i) {
+            Size length = columns[i].perUnderlying ?
+                header_->underlyings : header_->rows;
+            QL_REQUIRE(header_->offsets[i] % 8 == 0 &&
+                       header_->offsets[i] + length*columns[i].width
+                                                   <= region_.get_size(),
+                       path << " is truncated or corrupted");
+        }
+    }
+
+    ColumnarFile::ColumnarFile(const std::string& path, const char* magic,
+                               const Column* columns, Size columnCount,
+                               Size rows, Size underlyings) {
+        QL_REQUIRE(columnCount <= maxColumns, "too many columns");
+        Header header;
+        std::memset(&header, 0, sizeof(Header));
+        std::memcpy(header.magic, magic, 4);
+        header.version = version;
+        header.byteOrder = byteOrderMark;
+        header.columns = boost::uint32_t(columnCount);
+        header.rows = rows;
+        header.underlyings = underlyings;
+        Size size = aligned(sizeof(Header));
+        for (Size i=0; i<columnCount; ++i) {
+            header.offsets[i] = size;
+            size = aligned(size + columns[i].width *
+                           (columns[i].perUnderlying ? underlyings : rows));
+        }
+
+        {
+            // the file is sized before mapping; unwritten bytes are zero
+            std::ofstream out(path.c_str(),
+                              std::ios::binary | std::ios::trunc);
+            QL_REQUIRE(out, "cannot create " << path);
+            out.write(reinterpret_cast<const char*>(&header),
+                      sizeof(Header));
+            out.seekp(size-1);
+            out.put('\0');
+            QL_REQUIRE(out, "cannot write " << path);
+        }
+        map(path, true);
+    }
+
+    void ColumnarFile::map(const std::string& path, bool writable) {
+        boost::interprocess::mode_t mode = writable ?
+            boost::interprocess::read_write : boost::interprocess::read_only;
+        try {
+            boost::interprocess::file_mapping file(path.c_str(), mode);
+            boost::interprocess::mapped_region region(file, mode);
+            file_.swap(file);
+            region_.swap(region);
+        } catch (boost::interprocess::interprocess_exception& e) {
+            QL_FAIL("cannot map " << path << ": " << e.what());
+        }
+        header_ = static_cast<Header*>(region_.get_address());
+    }
+
+    void ColumnarFile::flush() {
+        region_.flush();
+    }
+
+
+    BookFile::BookFile(const std::string& path)
+    : ColumnarFile(path, "QLBK", columns_,
+                   sizeof(columns_)/sizeof(columns_[0]), false) {
+        // checked once, so that readers can index the market columns
+        const boost::uint32_t* indices = underlyingIndices();
+        for (Size i=0; i<rows(); ++i)
+            QL_REQUIRE(indices[i] < underlyings(),
+                       path << ": option " << i << " refers to underlying "
+                       << indices[i] << "; only " << underlyings()
+                       << " given");
+    }
+
+    BookFile::BookFile(const std::string& path, Size rows, Size underlyings)
+    : ColumnarFile(path, "QLBK", columns_,
+                   sizeof(columns_)/sizeof(columns_[0]),
+                   rows, underlyings) {}
+
+
+    ResultsFile::ResultsFile(const std::string& path)
+    : ColumnarFile(path, "QLRS", columns_,
+                   sizeof(columns_)/sizeof(columns_[0]), false) {}
+
+    ResultsFile::ResultsFile(const std::string& path, Size rows)
+    : ColumnarFile(path, "QLRS", columns_,
+                   sizeof(columns_)/sizeof(columns_[0]), rows, 0) {}
+
+}
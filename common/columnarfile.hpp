@@ -0,0 +1,174 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file columnarfile.hpp
+    \brief Memory-mapped columnar files for option books and results
+
+    A file starts with a fixed header holding a magic string, the
+    format version, a byte-order mark, the number of rows and of
+    underlyings, and the byte offset of each column; the columns
+    follow, each aligned to 8 bytes and stored as a contiguous array
+    of fixed-width values in native byte order. Opening a file maps
+    it into memory and checks the header, so that the columns can be
+    read in place without any parsing.
+
+    Book files hold one row per option and one per underlying:
+
+    - strike (double), expiry (32-bit date serial number), type
+      (8-bit, 1 for calls and -1 for puts), exercise (8-bit, 0 for
+      European and 1 for American) and underlying (32-bit index),
+      one per option;
+    - spot, rate, dividend and volatility (doubles, continuous
+      annual figures), one per underlying.
+
+    Results files have the same layout, with one row per option of
+    the corresponding book: NPV, delta, gamma, theta and error
+    estimate (doubles, NaN when not available) and status (8-bit,
+    0 if the option was priced).
+
+    The classes are implemented in columnarfile.cpp, which must be
+    compiled into the program.
+*/
+
+#ifndef imt_columnar_file_hpp
+#define imt_columnar_file_hpp
+
+#include <ql/option.hpp>
+#include <ql/time/date.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/noncopyable.hpp>
+#include <string>
+
+namespace QuantLib {
+
+    //! Memory-mapped file of fixed-width columns
+    /*! The column pointers of files opened for reading point to
+        read-only memory and must not be written to.
+    */
+    class ColumnarFile : private boost::noncopyable {
+      public:
+        static const boost::uint32_t version = 1;
+        static const Size maxColumns = 16;
+        struct Header {
+            char magic[4];
+            boost::uint32_t version;
+            boost::uint32_t byteOrder;
+            boost::uint32_t columns;
+            boost::uint64_t rows;
+            boost::uint64_t underlyings;
+            boost::uint64_t offsets[maxColumns];
+        };
+        //! number of rows, i.e., of options
+        Size rows() const { return Size(header_->rows); }
+        Size underlyings() const { return Size(header_->underlyings); }
+        //! forces the changes to be written to disk
+        void flush();
+      protected:
+        //! description of a column to be created
+        struct Column {
+            Size width;
+            bool perUnderlying;
+        };
+        //! maps an existing file
+        ColumnarFile(const std::string& path, const char* magic,
+                     const Column* columns, Size columnCount, bool writable);
+        //! creates and maps a file of the given size
+        ColumnarFile(const std::string& path, const char* magic,
+                     const Column* columns, Size columnCount,
+                     Size rows, Size underlyings);
+        template <class T>
+        T* column(Size i) const {
+            return reinterpret_cast<T*>(
+                       static_cast<char*>(region_.get_address()) +
+                       header_->offsets[i]);
+        }
+      private:
+        void map(const std::string& path, bool writable);
+        boost::interprocess::file_mapping file_;
+        boost::interprocess::mapped_region region_;
+        Header* header_;
+    };
+
+
+    //! Book of vanilla options
+    class BookFile : public ColumnarFile {
+      public:
+        /*! maps an existing book for reading; the underlying
+            indices are checked against the number of underlyings
+        */
+        explicit BookFile(const std::string& path);
+        //! creates a book to be filled through the column pointers
+        BookFile(const std::string& path, Size rows, Size underlyings);
+        //! \name columns
+        //@{
+        Real* strikes() const { return column<Real>(0); }
+        boost::int32_t* expiries() const {
+            return column<boost::int32_t>(1);
+        }
+        boost::int8_t* types() const { return column<boost::int8_t>(2); }
+        boost::int8_t* exercises() const {
+            return column<boost::int8_t>(3);
+        }
+        boost::uint32_t* underlyingIndices() const {
+            return column<boost::uint32_t>(4);
+        }
+        Real* spots() const { return column<Real>(5); }
+        Rate* rates() const { return column<Rate>(6); }
+        Rate* dividends() const { return column<Rate>(7); }
+        Volatility* volatilities() const { return column<Volatility>(8); }
+        //@}
+        //! \name row inspectors
+        //@{
+        Option::Type type(Size i) const {
+            return Option::Type(types()[i]);
+        }
+        Date expiry(Size i) const { return Date(expiries()[i]); }
+        bool american(Size i) const { return exercises()[i] != 0; }
+        //@}
+      private:
+        static const Column columns_[];
+    };
+
+
+    //! Results of the pricing of a book
+    class ResultsFile : public ColumnarFile {
+      public:
+        //! maps existing results for reading
+        explicit ResultsFile(const std::string& path);
+        //! creates results to be filled through the column pointers
+        ResultsFile(const std::string& path, Size rows);
+        //! \name columns
+        //@{
+        Real* npvs() const { return column<Real>(0); }
+        Real* deltas() const { return column<Real>(1); }
+        Real* gammas() const { return column<Real>(2); }
+        Real* thetas() const { return column<Real>(3); }
+        Real* errorEstimates() const { return column<Real>(4); }
+        boost::uint8_t* statuses() const {
+            return column<boost::uint8_t>(5);
+        }
+        //@}
+      private:
+        static const Column columns_[];
+    };
+
+}
+
+
+#endif
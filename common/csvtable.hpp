@@ -0,0 +1,87 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file csvtable.hpp
+    \brief Minimal reading of CSV files with a header line
+
+    Fields are separated by commas and trimmed; quoting is not
+    supported.
+*/
+
+#ifndef imt_csv_table_hpp
+#define imt_csv_table_hpp
+
+#include <ql/errors.hpp>
+#include <ql/types.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace QuantLib {
+
+    inline std::string trimCsvField(const std::string& s) {
+        std::string::size_type first = s.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+            return "";
+        std::string::size_type last = s.find_last_not_of(" \t\r");
+        return s.substr(first, last-first+1);
+    }
+
+    inline std::vector<std::string> splitCsvLine(const std::string& line) {
+        std::vector<std::string> fields;
+        std::string::size_type start = 0;
+        for (;;) {
+            std::string::size_type end = line.find(',', start);
+            fields.push_back(trimCsvField(line.substr(start, end-start)));
+            if (end == std::string::npos)
+                return fields;
+            start = end+1;
+        }
+    }
+
+    //! Positions of the named columns of a CSV file
+    class CsvColumns {
+      public:
+        //! reads the names from the header line
+        explicit CsvColumns(const std::string& header) {
+            std::vector<std::string> names = splitCsvLine(header);
+            for (Size i=0; i<names.size(); ++i)
+                positions_[names[i]] = i;
+        }
+        bool has(const std::string& name) const {
+            return positions_.count(name) != 0;
+        }
+        void require(const std::string& name) const {
+            QL_REQUIRE(has(name), "missing column: " << name);
+        }
+        //! the field of a split line in the given column
+        const std::string& field(const std::vector<std::string>& fields,
+                                 const std::string& name) const {
+            std::map<std::string, Size>::const_iterator i =
+                positions_.find(name);
+            QL_REQUIRE(i != positions_.end(), "missing column: " << name);
+            QL_REQUIRE(i->second < fields.size(), "missing field: " << name);
+            return fields[i->second];
+        }
+      private:
+        std::map<std::string, Size> positions_;
+    };
+
+}
+
+
+#endif
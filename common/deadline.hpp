@@ -0,0 +1,64 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file deadline.hpp
+    \brief Wall-clock deadline for anytime calculations
+*/
+
+#ifndef imt_deadline_hpp
+#define imt_deadline_hpp
+
+#include <ql/types.hpp>
+#include <ql/errors.hpp>
+#include <boost/chrono.hpp>
+
+namespace QuantLib {
+
+    //! Wall-clock deadline measured on a monotonic clock
+    /*! Engines working in anytime mode query the deadline before
+        starting each unit of work and only start it if its estimated
+        duration fits in the remaining time.
+    */
+    class Deadline {
+      public:
+        typedef boost::chrono::steady_clock clock_type;
+        //! deadline the given number of seconds from now
+        explicit Deadline(Real seconds)
+        : start_(clock_type::now()), seconds_(seconds) {
+            QL_REQUIRE(seconds > 0.0,
+                       "positive time budget required, "
+                       << seconds << " given");
+        }
+        //! seconds since the deadline was set
+        Real elapsed() const {
+            return boost::chrono::duration<Real>(
+                                       clock_type::now() - start_).count();
+        }
+        //! seconds left before the deadline; negative if expired
+        Real remaining() const { return seconds_ - elapsed(); }
+        bool expired() const { return remaining() <= 0.0; }
+        //! whether work of the given duration would end in time
+        bool allows(Real seconds) const { return seconds <= remaining(); }
+      private:
+        clock_type::time_point start_;
+        Real seconds_;
+    };
+
+}
+
+
+#endif
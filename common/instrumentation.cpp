@@ -0,0 +1,187 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include "instrumentation.hpp"
+#include <boost/chrono.hpp>
+#include <boost/thread/locks.hpp>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+namespace {
+
+    // plain globals, since they are updated from operator new
+    boost::atomic<long long> allocations_(0);
+    boost::atomic<long long> allocatedBytes_(0);
+
+}
+
+#if defined(IMT_ENABLE_INSTRUMENTATION) && defined(IMT_COUNT_ALLOCATIONS)
+
+void* operator new(std::size_t size) {
+    allocations_.fetch_add(1, boost::memory_order_relaxed);
+    allocatedBytes_.fetch_add(size, boost::memory_order_relaxed);
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+void operator delete[](void* p) throw() {
+    std::free(p);
+}
+
+#endif
+
+namespace QuantLib {
+
+    const Size Instrumentation::maxEventsPerThread;
+
+    long long allocationCount() {
+        return allocations_.load(boost::memory_order_relaxed);
+    }
+
+    long long allocatedBytes() {
+        return allocatedBytes_.load(boost::memory_order_relaxed);
+    }
+
+    long long Instrumentation::now() {
+        return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+            boost::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    InstrumentationCounter& Instrumentation::counter(
+                                                  const std::string& name) {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        boost::shared_ptr<InstrumentationCounter>& c = counters_[name];
+        if (!c)
+            c = boost::shared_ptr<InstrumentationCounter>(
+                                          new InstrumentationCounter(name));
+        return *c;
+    }
+
+    InstrumentationTimer& Instrumentation::timer(const std::string& name) {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        boost::shared_ptr<InstrumentationTimer>& t = timers_[name];
+        if (!t)
+            t = boost::shared_ptr<InstrumentationTimer>(
+                                            new InstrumentationTimer(name));
+        return *t;
+    }
+
+    Instrumentation::ThreadBuffer& Instrumentation::threadBuffer() {
+        ThreadBuffer* buffer = current_.get();
+        if (!buffer) {
+            boost::shared_ptr<ThreadBuffer> b(new ThreadBuffer);
+            b->dropped = 0;
+            {
+                boost::lock_guard<boost::mutex> lock(mutex_);
+                b->id = buffers_.size() + 1;
+                buffers_.push_back(b);
+            }
+            // the registry keeps ownership; see releaseBuffer
+            current_.reset(b.get());
+            buffer = b.get();
+        }
+        return *buffer;
+    }
+
+    void Instrumentation::record(const TraceEvent& event) {
+        ThreadBuffer& buffer = threadBuffer();
+        boost::lock_guard<boost::mutex> lock(buffer.mutex);
+        if (buffer.events.size() < maxEventsPerThread)
+            buffer.events.push_back(event);
+        else
+            ++buffer.dropped;
+    }
+
+    void Instrumentation::writeChromeTrace(std::ostream& out) const {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        out << std::fixed << std::setprecision(3);
+        for (Size i=0; i<buffers_.size(); ++i) {
+            const ThreadBuffer& buffer = *buffers_[i];
+            boost::lock_guard<boost::mutex> bufferLock(buffer.mutex);
+            for (Size j=0; j<buffer.events.size(); ++j) {
+                const TraceEvent& e = buffer.events[j];
+                if (!first)
+                    out << ",";
+                first = false;
+                // timestamps and durations are in microseconds
+                out << "\n{\"name\":\"" << e.timer->name() << "\","
+                    << "\"cat\":\"imt\",\"ph\":\"X\","
+                    << "\"ts\":" << e.start/1000.0 << ","
+                    << "\"dur\":" << e.duration/1000.0 << ","
+                    << "\"pid\":1,\"tid\":" << buffer.id << "}";
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+    void Instrumentation::writeCounters(std::ostream& out) const {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        for (std::map<std::string,
+                      boost::shared_ptr<InstrumentationCounter> >::
+                 const_iterator i = counters_.begin();
+             i != counters_.end(); ++i)
+            out << i->first << " " << i->second->value() << "\n";
+        for (std::map<std::string,
+                      boost::shared_ptr<InstrumentationTimer> >::
+                 const_iterator i = timers_.begin();
+             i != timers_.end(); ++i) {
+            out << i->first << ".calls " << i->second->calls() << "\n";
+            out << i->first << ".ns " << i->second->nanoseconds() << "\n";
+        }
+        long long dropped = 0;
+        for (Size i=0; i<buffers_.size(); ++i) {
+            boost::lock_guard<boost::mutex> bufferLock(buffers_[i]->mutex);
+            dropped += buffers_[i]->dropped;
+        }
+        out << "instrumentation.droppedEvents " << dropped << "\n";
+        out << "heap.allocations " << allocationCount() << "\n";
+        out << "heap.bytes " << allocatedBytes() << "\n";
+    }
+
+    void Instrumentation::reset() {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        for (std::map<std::string,
+                      boost::shared_ptr<InstrumentationCounter> >::
+                 iterator i = counters_.begin();
+             i != counters_.end(); ++i)
+            i->second->reset();
+        for (std::map<std::string,
+                      boost::shared_ptr<InstrumentationTimer> >::
+                 iterator i = timers_.begin();
+             i != timers_.end(); ++i)
+            i->second->reset();
+        for (Size i=0; i<buffers_.size(); ++i) {
+            boost::lock_guard<boost::mutex> bufferLock(buffers_[i]->mutex);
+            buffers_[i]->events.clear();
+            buffers_[i]->dropped = 0;
+        }
+    }
+
+}
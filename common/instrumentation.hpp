@@ -0,0 +1,218 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file instrumentation.hpp
+    \brief Compile-time optional counters and trace spans
+
+    Engines mark their phases with the IMT_* macros below. Unless
+    IMT_ENABLE_INSTRUMENTATION is defined, the macros expand to
+    nothing and their arguments are not evaluated, so that the
+    instrumentation has no cost at all. When it is defined,
+    instrumentation.cpp must be compiled into the program; defining
+    IMT_COUNT_ALLOCATIONS as well makes it replace the global
+    operator new in order to count heap allocations.
+
+    Spans are meant for phases lasting microseconds or more: each
+    costs two reads of the monotonic clock and the append of an event
+    to a buffer owned by the calling thread. Counters and timers are
+    looked up once per call site and updated atomically.
+*/
+
+#ifndef imt_instrumentation_hpp
+#define imt_instrumentation_hpp
+
+#include <ql/patterns/singleton.hpp>
+#include <ql/types.hpp>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/noncopyable.hpp>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef IMT_ENABLE_INSTRUMENTATION
+
+#define IMT_CONCAT_(a, b) a##b
+#define IMT_CONCAT(a, b) IMT_CONCAT_(a, b)
+
+/*! adds n to the named counter */
+#define IMT_COUNT(name, n) \
+    do { \
+        static QuantLib::InstrumentationCounter& imt_counter = \
+            QuantLib::Instrumentation::instance().counter(name); \
+        imt_counter.add(n); \
+    } while (false)
+
+/*! times the enclosing scope and records it as a trace event */
+#define IMT_TRACE_SCOPE(name) \
+    static QuantLib::InstrumentationTimer& IMT_CONCAT(imt_timer_, __LINE__) = \
+        QuantLib::Instrumentation::instance().timer(name); \
+    QuantLib::TraceSpan IMT_CONCAT(imt_span_, __LINE__)( \
+                                       IMT_CONCAT(imt_timer_, __LINE__))
+
+/*! starts a span that is closed explicitly by IMT_TRACE_END */
+#define IMT_TRACE_BEGIN(span, name) \
+    static QuantLib::InstrumentationTimer& IMT_CONCAT(span, _timer) = \
+        QuantLib::Instrumentation::instance().timer(name); \
+    QuantLib::TraceSpan span(IMT_CONCAT(span, _timer))
+
+#define IMT_TRACE_END(span) span.end()
+
+#else
+
+#define IMT_COUNT(name, n)
+#define IMT_TRACE_SCOPE(name)
+#define IMT_TRACE_BEGIN(span, name)
+#define IMT_TRACE_END(span)
+
+#endif
+
+namespace QuantLib {
+
+    //! Named event counter
+    class InstrumentationCounter : private boost::noncopyable {
+      public:
+        explicit InstrumentationCounter(const std::string& name)
+        : name_(name), value_(0) {}
+        const std::string& name() const { return name_; }
+        void add(long long n) {
+            value_.fetch_add(n, boost::memory_order_relaxed);
+        }
+        long long value() const {
+            return value_.load(boost::memory_order_relaxed);
+        }
+        void reset() { value_.store(0, boost::memory_order_relaxed); }
+      private:
+        std::string name_;
+        boost::atomic<long long> value_;
+    };
+
+
+    //! Named accumulator of the time spent in a phase
+    class InstrumentationTimer : private boost::noncopyable {
+      public:
+        explicit InstrumentationTimer(const std::string& name)
+        : name_(name), nanoseconds_(0), calls_(0) {}
+        const std::string& name() const { return name_; }
+        void add(long long nanoseconds, long long calls = 1) {
+            nanoseconds_.fetch_add(nanoseconds, boost::memory_order_relaxed);
+            calls_.fetch_add(calls, boost::memory_order_relaxed);
+        }
+        long long nanoseconds() const {
+            return nanoseconds_.load(boost::memory_order_relaxed);
+        }
+        long long calls() const {
+            return calls_.load(boost::memory_order_relaxed);
+        }
+        void reset() {
+            nanoseconds_.store(0, boost::memory_order_relaxed);
+            calls_.store(0, boost::memory_order_relaxed);
+        }
+      private:
+        std::string name_;
+        boost::atomic<long long> nanoseconds_, calls_;
+    };
+
+
+    //! Completed span, as exported to the trace
+    struct TraceEvent {
+        const InstrumentationTimer* timer;
+        long long start, duration;
+    };
+
+
+    //! Registry of counters, timers and trace events
+    /*! Exports should be made while no instrumented calculation is
+        running; otherwise, they see a consistent but partial state.
+    */
+    class Instrumentation : public Singleton<Instrumentation> {
+        friend class Singleton<Instrumentation>;
+      public:
+        //! events kept per thread; further ones only update the timers
+        static const Size maxEventsPerThread = 1048576;
+        //! returns the counter with the given name, creating it if needed
+        InstrumentationCounter& counter(const std::string& name);
+        //! returns the timer with the given name, creating it if needed
+        InstrumentationTimer& timer(const std::string& name);
+        //! appends a completed span to the buffer of the calling thread
+        void record(const TraceEvent& event);
+        //! nanoseconds on the monotonic clock
+        static long long now();
+        //! writes the events in the Chrome trace-event JSON format
+        void writeChromeTrace(std::ostream& out) const;
+        //! writes counters and timers as "name value" lines
+        void writeCounters(std::ostream& out) const;
+        //! clears events and zeroes counters and timers
+        void reset();
+      private:
+        Instrumentation() : current_(&releaseBuffer) {}
+        struct ThreadBuffer {
+            Size id;
+            std::vector<TraceEvent> events;
+            long long dropped;
+            mutable boost::mutex mutex;
+        };
+        ThreadBuffer& threadBuffer();
+        // buffers are owned by the registry and outlive their threads
+        static void releaseBuffer(ThreadBuffer*) {}
+        mutable boost::mutex mutex_;
+        std::map<std::string, boost::shared_ptr<InstrumentationCounter> >
+                                                                  counters_;
+        std::map<std::string, boost::shared_ptr<InstrumentationTimer> >
+                                                                    timers_;
+        std::vector<boost::shared_ptr<ThreadBuffer> > buffers_;
+        boost::thread_specific_ptr<ThreadBuffer> current_;
+    };
+
+
+    //! RAII span updating a timer and recording a trace event
+    class TraceSpan : private boost::noncopyable {
+      public:
+        explicit TraceSpan(InstrumentationTimer& timer)
+        : timer_(timer), start_(Instrumentation::now()), open_(true) {}
+        ~TraceSpan() { end(); }
+        void end() {
+            if (open_) {
+                open_ = false;
+                TraceEvent event;
+                event.timer = &timer_;
+                event.start = start_;
+                event.duration = Instrumentation::now() - start_;
+                timer_.add(event.duration);
+                Instrumentation::instance().record(event);
+            }
+        }
+      private:
+        InstrumentationTimer& timer_;
+        long long start_;
+        bool open_;
+    };
+
+
+    //! heap allocations counted since the start of the program
+    /*! zero unless IMT_COUNT_ALLOCATIONS is defined */
+    long long allocationCount();
+    //! bytes requested by the counted heap allocations
+    long long allocatedBytes();
+
+}
+
+
+#endif
@@ -0,0 +1,85 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file pricingprotocol.hpp
+    \brief Binary protocol of the local pricing server
+
+    Clients and server exchange fixed-size frames over a Unix domain
+    socket, in native byte order since both run on the same machine.
+    Each request frame gets exactly one response frame with the same
+    id; responses to price requests may come back in a different
+    order than the requests, while health and statistics requests
+    are answered immediately.
+
+    The fields of price requests follow the conventions of book files
+    (see columnarfile.hpp): the expiry is a date serial number, the
+    type is 1 for calls and -1 for puts, the exercise 0 for European
+    and 1 for American, and rates and volatility are continuous
+    annual figures. Requests on the same underlying id are expected
+    to carry the same market data until it moves.
+
+    The values of the response depend on the request:
+
+    - price: NPV, delta, gamma, theta, vega and error estimate, NaN
+      when not provided by the engine;
+    - health: uptime in seconds, open connections, queued price
+      requests and underlyings seen so far;
+    - statistics: price requests, failed ones, batches, requests
+      answered from the cache, and the median, 99th percentile and
+      maximum latency in seconds over the last requests.
+
+    Unused values are NaN.
+*/
+
+#ifndef imt_pricing_protocol_hpp
+#define imt_pricing_protocol_hpp
+
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+
+namespace QuantLib {
+
+    struct PricingMessage {
+        enum Kind { Price = 1, Health = 2, Statistics = 3 };
+        enum Status { Ok = 0, PricingError = 1, BadRequest = 2 };
+        static const unsigned int values = 8;
+    };
+
+    struct PricingRequestFrame {
+        boost::uint32_t kind;
+        boost::uint32_t underlying;
+        boost::uint64_t id;
+        double strike, spot, rate, dividend, volatility;
+        boost::int32_t expiry;
+        boost::int8_t type, exercise;
+        boost::uint8_t padding[2];
+    };
+
+    struct PricingResponseFrame {
+        boost::uint32_t kind;
+        boost::uint32_t status;
+        boost::uint64_t id;
+        double values[PricingMessage::values];
+    };
+
+    BOOST_STATIC_ASSERT(sizeof(PricingRequestFrame) == 64);
+    BOOST_STATIC_ASSERT(sizeof(PricingResponseFrame) == 80);
+
+}
+
+
+#endif
@@ -0,0 +1,465 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include "pricingserver.hpp"
+#include <ql/exercise.hpp>
+#include <ql/termstructures/yield/flatforward.hpp>
+#include <ql/termstructures/volatility/equityfx/blackconstantvol.hpp>
+#include <ql/time/calendars/nullcalendar.hpp>
+#include <ql/time/daycounters/actual365fixed.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <algorithm>
+#include <limits>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace QuantLib {
+
+    struct PricingServer::Connection {
+        explicit Connection(boost::asio::io_service& service)
+        : socket(service) {}
+        boost::asio::local::stream_protocol::socket socket;
+        boost::mutex writeMutex;
+    };
+
+    namespace {
+
+        typedef boost::asio::local::stream_protocol protocol;
+
+        PricingResponseFrame emptyResponse(
+                                      const PricingRequestFrame& request) {
+            PricingResponseFrame response;
+            response.kind = request.kind;
+            response.status = PricingMessage::Ok;
+            response.id = request.id;
+            std::fill(response.values,
+                      response.values + PricingMessage::values,
+                      std::numeric_limits<Real>::quiet_NaN());
+            return response;
+        }
+
+        Real nanIfNull(Real x) {
+            return x == Null<Real>() ?
+                std::numeric_limits<Real>::quiet_NaN() : x;
+        }
+
+        // only sockets are removed, in case the path is mistyped
+        void removeSocketFile(const std::string& path) {
+            struct stat status;
+            if (::stat(path.c_str(), &status) == 0 &&
+                S_ISSOCK(status.st_mode))
+                ::unlink(path.c_str());
+        }
+
+    }
+
+    const Size PricingServer::maxCachedResults;
+    const Size PricingServer::latencyWindow;
+
+    bool PricingServer::ResultKey::operator<(const ResultKey& o) const {
+        if (type != o.type)
+            return type < o.type;
+        if (exercise != o.exercise)
+            return exercise < o.exercise;
+        if (expiry != o.expiry)
+            return expiry < o.expiry;
+        return strike < o.strike;
+    }
+
+
+    PricingServer::PricingServer(const std::string& socketPath,
+                                 const EngineFactory& factory,
+                                 const Date& valuationDate,
+                                 Size threads)
+    : socketPath_(socketPath), factory_(factory),
+      valuationDate_(valuationDate), started_(now()), acceptor_(service_),
+      stopping_(false), requests_(0), errors_(0), batches_(0),
+      cacheHits_(0), queued_(0), latencies_(latencyWindow),
+      latencyCount_(0) {
+        removeSocketFile(socketPath_);
+        try {
+            protocol::endpoint endpoint(socketPath_);
+            acceptor_.open(endpoint.protocol());
+            acceptor_.bind(endpoint);
+            acceptor_.listen();
+        } catch (std::exception& e) {
+            QL_FAIL("cannot listen on " << socketPath_ << ": " << e.what());
+        }
+        if (threads == 0)
+            threads = std::max<Size>(boost::thread::hardware_concurrency(),
+                                     1);
+        for (Size i=0; i<threads; ++i)
+            workers_.create_thread(boost::bind(&PricingServer::work, this));
+    }
+
+    PricingServer::~PricingServer() {
+        stop();
+        // the workers drain the queue and release its connections
+        workers_.join_all();
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (!connections_.empty())
+                closed_.wait(lock);
+        }
+        boost::system::error_code error;
+        acceptor_.close(error);
+        removeSocketFile(socketPath_);
+    }
+
+    void PricingServer::run() {
+        for (;;) {
+            boost::shared_ptr<Connection> connection(
+                                               new Connection(service_));
+            boost::system::error_code error;
+            acceptor_.accept(connection->socket, error);
+            {
+                boost::lock_guard<boost::mutex> lock(mutex_);
+                if (stopping_)
+                    return;
+                if (error)
+                    continue;
+                connections_.push_back(connection);
+            }
+            boost::thread(boost::bind(&PricingServer::serve, this,
+                                      boost::weak_ptr<Connection>(
+                                                     connection))).detach();
+        }
+    }
+
+    void PricingServer::stop() {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            if (stopping_)
+                return;
+            stopping_ = true;
+            // makes the readers' blocking reads return
+            std::list<boost::shared_ptr<Connection> >::iterator i;
+            for (i = connections_.begin(); i != connections_.end(); ++i)
+                ::shutdown((*i)->socket.native_handle(), SHUT_RDWR);
+        }
+        ready_.notify_all();
+        // makes run() return from accept
+        boost::system::error_code error;
+        protocol::socket socket(service_);
+        socket.connect(protocol::endpoint(socketPath_), error);
+    }
+
+    void PricingServer::serve(const boost::weak_ptr<Connection>& weak) {
+        // only this reference and the list keep the connection alive,
+        // so that its socket is closed before the server is destroyed
+        boost::shared_ptr<Connection> connection = weak.lock();
+        for (;;) {
+            Request request;
+            boost::system::error_code error;
+            boost::asio::read(connection->socket,
+                              boost::asio::buffer(&request.frame,
+                                                  sizeof(request.frame)),
+                              error);
+            if (error)
+                break;
+            request.received = now();
+            switch (request.frame.kind) {
+              case PricingMessage::Price:
+                request.connection = connection;
+                enqueue(request);
+                break;
+              case PricingMessage::Health:
+              case PricingMessage::Statistics:
+                reply(*connection, statisticsFrame(request.frame));
+                break;
+              default: {
+                PricingResponseFrame response = emptyResponse(request.frame);
+                response.status = PricingMessage::BadRequest;
+                reply(*connection, response);
+              }
+            }
+        }
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        connections_.remove(connection);
+        connection.reset();
+        closed_.notify_all();
+    }
+
+    void PricingServer::enqueue(const Request& request) {
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            if (stopping_)
+                return;
+            Underlying& underlying =
+                underlyings_[request.frame.underlying];
+            underlying.queue.push_back(request);
+            ++queued_;
+            if (underlying.scheduled)
+                return;
+            underlying.scheduled = true;
+            scheduled_.push_back(&underlying);
+        }
+        ready_.notify_one();
+    }
+
+    void PricingServer::work() {
+        std::vector<Request> batch;
+        for (;;) {
+            Underlying* underlying;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex_);
+                while (scheduled_.empty() && !stopping_)
+                    ready_.wait(lock);
+                if (scheduled_.empty())
+                    return;
+                underlying = scheduled_.front();
+                scheduled_.pop_front();
+                batch.assign(underlying->queue.begin(),
+                             underlying->queue.end());
+                underlying->queue.clear();
+                queued_ -= batch.size();
+                ++batches_;
+            }
+
+            price(*underlying, batch);
+            batch.clear();
+
+            {
+                // requests that came in meanwhile make a new batch
+                boost::lock_guard<boost::mutex> lock(mutex_);
+                if (underlying->queue.empty()) {
+                    underlying->scheduled = false;
+                    continue;
+                }
+                scheduled_.push_back(underlying);
+            }
+            ready_.notify_one();
+        }
+    }
+
+    void PricingServer::price(Underlying& underlying,
+                              const std::vector<Request>& batch) {
+        std::vector<long long> latencies(batch.size());
+        Size errors = 0, cacheHits = 0;
+        for (Size i=0; i<batch.size(); ++i) {
+            bool cached = false;
+            PricingResponseFrame response =
+                price(underlying, batch[i].frame, cached);
+            reply(*batch[i].connection, response);
+            latencies[i] = now() - batch[i].received;
+            if (response.status != PricingMessage::Ok)
+                ++errors;
+            if (cached)
+                ++cacheHits;
+        }
+
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        requests_ += batch.size();
+        errors_ += errors;
+        cacheHits_ += cacheHits;
+        for (Size i=0; i<latencies.size(); ++i)
+            latencies_[latencyCount_++ % latencyWindow] = latencies[i];
+    }
+
+    PricingResponseFrame PricingServer::price(
+                                       Underlying& underlying,
+                                       const PricingRequestFrame& request,
+                                       bool& cached) {
+        PricingResponseFrame response = emptyResponse(request);
+        if ((request.type != 1 && request.type != -1) ||
+            (request.exercise != 0 && request.exercise != 1)) {
+            response.status = PricingMessage::BadRequest;
+            return response;
+        }
+        try {
+            prepare(underlying, request);
+
+            ResultKey key;
+            key.type = request.type;
+            key.exercise = request.exercise;
+            key.expiry = request.expiry;
+            key.strike = request.strike;
+            std::map<ResultKey, PricingResponseFrame>::const_iterator i =
+                underlying.results.find(key);
+            if (i != underlying.results.end()) {
+                std::copy(i->second.values,
+                          i->second.values + PricingMessage::values,
+                          response.values);
+                cached = true;
+                return response;
+            }
+
+            const boost::shared_ptr<PricingEngine>& engine =
+                underlying.engine;
+            engine->reset();
+            VanillaOption::arguments* arguments =
+                dynamic_cast<VanillaOption::arguments*>(
+                                                  engine->getArguments());
+            QL_REQUIRE(arguments, "wrong argument type");
+            Date expiry(request.expiry);
+            arguments->payoff = boost::shared_ptr<Payoff>(
+                      new PlainVanillaPayoff(Option::Type(request.type),
+                                             request.strike));
+            if (request.exercise == 1)
+                arguments->exercise = boost::shared_ptr<Exercise>(
+                              new AmericanExercise(valuationDate_, expiry));
+            else
+                arguments->exercise = boost::shared_ptr<Exercise>(
+                                             new EuropeanExercise(expiry));
+            arguments->validate();
+            engine->calculate();
+
+            const VanillaOption::results* results =
+                dynamic_cast<const VanillaOption::results*>(
+                                                    engine->getResults());
+            QL_REQUIRE(results, "wrong result type");
+            response.values[0] = nanIfNull(results->value);
+            response.values[1] = nanIfNull(results->delta);
+            response.values[2] = nanIfNull(results->gamma);
+            response.values[3] = nanIfNull(results->theta);
+            response.values[4] = nanIfNull(results->vega);
+            response.values[5] = nanIfNull(results->errorEstimate);
+
+            if (underlying.results.size() >= maxCachedResults)
+                underlying.results.clear();
+            underlying.results[key] = response;
+        } catch (std::exception&) {
+            response.status = PricingMessage::PricingError;
+        }
+        return response;
+    }
+
+    void PricingServer::prepare(Underlying& underlying,
+                                const PricingRequestFrame& request) {
+        if (underlying.engine) {
+            if (underlying.spot->value() == request.spot &&
+                underlying.rate->value() == request.rate &&
+                underlying.dividend->value() == request.dividend &&
+                underlying.volatility->value() == request.volatility)
+                return;
+            // the quotes notify the engine through the process
+            underlying.spot->setValue(request.spot);
+            underlying.rate->setValue(request.rate);
+            underlying.dividend->setValue(request.dividend);
+            underlying.volatility->setValue(request.volatility);
+            underlying.results.clear();
+            return;
+        }
+
+        boost::shared_ptr<SimpleQuote> spot(new SimpleQuote(request.spot));
+        boost::shared_ptr<SimpleQuote> rate(new SimpleQuote(request.rate));
+        boost::shared_ptr<SimpleQuote> dividend(
+                                        new SimpleQuote(request.dividend));
+        boost::shared_ptr<SimpleQuote> volatility(
+                                      new SimpleQuote(request.volatility));
+        DayCounter dayCounter = Actual365Fixed();
+        Handle<YieldTermStructure> riskFree(
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(valuationDate_, Handle<Quote>(rate),
+                                dayCounter)));
+        Handle<YieldTermStructure> dividends(
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(valuationDate_, Handle<Quote>(dividend),
+                                dayCounter)));
+        Handle<BlackVolTermStructure> blackVolatility(
+            boost::shared_ptr<BlackVolTermStructure>(
+                new BlackConstantVol(valuationDate_, NullCalendar(),
+                                     Handle<Quote>(volatility),
+                                     dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process(
+            new BlackScholesMertonProcess(Handle<Quote>(spot), dividends,
+                                          riskFree, blackVolatility));
+
+        underlying.engine = factory_(process);
+        underlying.spot = spot;
+        underlying.rate = rate;
+        underlying.dividend = dividend;
+        underlying.volatility = volatility;
+    }
+
+    void PricingServer::reply(Connection& connection,
+                              const PricingResponseFrame& response) {
+        // a client gone away is noticed by its reader
+        boost::lock_guard<boost::mutex> lock(connection.writeMutex);
+        boost::system::error_code error;
+        boost::asio::write(connection.socket,
+                           boost::asio::buffer(&response, sizeof(response)),
+                           error);
+    }
+
+    PricingServerStatistics PricingServer::statistics() const {
+        PricingServerStatistics statistics;
+        std::vector<long long> latencies;
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            statistics.requests = requests_;
+            statistics.errors = errors_;
+            statistics.batches = batches_;
+            statistics.cacheHits = cacheHits_;
+            statistics.connections = connections_.size();
+            statistics.queued = queued_;
+            statistics.underlyings = underlyings_.size();
+            latencies.assign(latencies_.begin(),
+                             latencies_.begin() +
+                                 std::min(latencyCount_, latencyWindow));
+        }
+        statistics.uptime = (now() - started_) * 1.0e-9;
+
+        statistics.medianLatency = statistics.latency99 =
+            statistics.maxLatency = Null<Real>();
+        if (!latencies.empty()) {
+            Size n = latencies.size();
+            std::vector<long long>::iterator median =
+                latencies.begin() + (n-1)/2;
+            std::nth_element(latencies.begin(), median, latencies.end());
+            statistics.medianLatency = *median * 1.0e-9;
+            std::vector<long long>::iterator p99 =
+                latencies.begin() + Size(0.99*(n-1));
+            std::nth_element(latencies.begin(), p99, latencies.end());
+            statistics.latency99 = *p99 * 1.0e-9;
+            statistics.maxLatency =
+                *std::max_element(p99, latencies.end()) * 1.0e-9;
+        }
+        return statistics;
+    }
+
+    PricingResponseFrame PricingServer::statisticsFrame(
+                                 const PricingRequestFrame& request) const {
+        PricingResponseFrame response = emptyResponse(request);
+        PricingServerStatistics s = statistics();
+        if (request.kind == PricingMessage::Health) {
+            response.values[0] = s.uptime;
+            response.values[1] = Real(s.connections);
+            response.values[2] = Real(s.queued);
+            response.values[3] = Real(s.underlyings);
+        } else {
+            response.values[0] = Real(s.requests);
+            response.values[1] = Real(s.errors);
+            response.values[2] = Real(s.batches);
+            response.values[3] = Real(s.cacheHits);
+            response.values[4] = nanIfNull(s.medianLatency);
+            response.values[5] = nanIfNull(s.latency99);
+            response.values[6] = nanIfNull(s.maxLatency);
+        }
+        return response;
+    }
+
+    long long PricingServer::now() {
+        return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+            boost::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+}
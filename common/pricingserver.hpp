@@ -0,0 +1,170 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file pricingserver.hpp
+    \brief Resident vanilla pricing server on a Unix domain socket
+
+    The class is implemented in pricingserver.cpp, which must be
+    compiled into the program.
+*/
+
+#ifndef imt_pricing_server_hpp
+#define imt_pricing_server_hpp
+
+#include "pricingprotocol.hpp"
+#include <ql/instruments/vanillaoption.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include <ql/quotes/simplequote.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Statistics of a pricing server
+    struct PricingServerStatistics {
+        Size requests, errors, batches, cacheHits;
+        Size connections, queued, underlyings;
+        //! seconds since the server was created
+        Real uptime;
+        //! latencies in seconds over the last requests
+        Real medianLatency, latency99, maxLatency;
+    };
+
+
+    //! Vanilla pricing server for local clients
+    /*! Clients connect to a Unix domain socket and exchange the
+        frames described in pricingprotocol.hpp; each connection is
+        read by its own thread, and price requests are queued by
+        underlying.
+
+        A worker thread takes all the requests queued on an
+        underlying at once and prices them as a batch; the underlying
+        is not given to another worker until the batch is done, so
+        that its market objects and engine are only used by one
+        thread at a time and need no locking. They are built for the
+        first request on the underlying and kept for the life of the
+        server: when the market data in a request differ, the quotes
+        are set to the new values and the engine is recalculated
+        through the observers, rather than rebuilt. Results are also
+        kept until the market data move, so that repeated requests
+        are answered without pricing.
+
+        Latency is measured from the reading of a request to the
+        writing of its response.
+    */
+    class PricingServer : private boost::noncopyable {
+      public:
+        typedef boost::function<boost::shared_ptr<PricingEngine>(
+                const boost::shared_ptr<GeneralizedBlackScholesProcess>&)>
+                                                            EngineFactory;
+        //! results kept per underlying before they're all dropped
+        static const Size maxCachedResults = 4096;
+        //! requests whose latency is kept for the statistics
+        static const Size latencyWindow = 65536;
+
+        /*! Binds the socket, replacing any stale socket file at the
+            given path, and starts the workers.
+
+            \param factory        called once per underlying to build
+                                  its engine
+            \param valuationDate  reference date of the market
+            \param threads        worker threads; 0 for one per core
+        */
+        PricingServer(const std::string& socketPath,
+                      const EngineFactory& factory,
+                      const Date& valuationDate,
+                      Size threads = 0);
+        /*! stops the server and closes all connections; run() must
+            have returned.
+        */
+        ~PricingServer();
+
+        //! accepts connections until stop() is called
+        void run();
+        //! makes run() return; can be called from any thread
+        void stop();
+
+        PricingServerStatistics statistics() const;
+      private:
+        struct Connection;
+        struct Request {
+            PricingRequestFrame frame;
+            boost::shared_ptr<Connection> connection;
+            long long received;
+        };
+        struct ResultKey {
+            boost::int8_t type, exercise;
+            boost::int32_t expiry;
+            Real strike;
+            bool operator<(const ResultKey&) const;
+        };
+        struct Underlying {
+            Underlying() : scheduled(false) {}
+            std::deque<Request> queue;
+            // queued for a worker or being priced
+            bool scheduled;
+            // only used by the worker pricing the underlying
+            boost::shared_ptr<SimpleQuote> spot, rate, dividend, volatility;
+            boost::shared_ptr<PricingEngine> engine;
+            std::map<ResultKey, PricingResponseFrame> results;
+        };
+        void serve(const boost::weak_ptr<Connection>&);
+        void enqueue(const Request&);
+        void work();
+        void price(Underlying&, const std::vector<Request>&);
+        PricingResponseFrame price(Underlying&, const PricingRequestFrame&,
+                                   bool& cached);
+        void prepare(Underlying&, const PricingRequestFrame&);
+        static void reply(Connection&, const PricingResponseFrame&);
+        PricingResponseFrame statisticsFrame(
+                                   const PricingRequestFrame&) const;
+        static long long now();
+
+        std::string socketPath_;
+        EngineFactory factory_;
+        Date valuationDate_;
+        long long started_;
+        boost::asio::io_service service_;
+        boost::asio::local::stream_protocol::acceptor acceptor_;
+
+        mutable boost::mutex mutex_;
+        boost::condition_variable ready_, closed_;
+        std::map<boost::uint32_t, Underlying> underlyings_;
+        std::deque<Underlying*> scheduled_;
+        std::list<boost::shared_ptr<Connection> > connections_;
+        bool stopping_;
+        Size requests_, errors_, batches_, cacheHits_, queued_;
+        std::vector<long long> latencies_;
+        Size latencyCount_;
+        boost::thread_group workers_;
+    };
+
+}
+
+
+#endif
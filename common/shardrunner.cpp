@@ -0,0 +1,219 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include "shardrunner.hpp"
+#include <ql/errors.hpp>
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace QuantLib {
+
+    struct ShardRunner::Worker {
+        Worker() : pid(-1), fd(-1) {}
+        // assigned shards whose result wasn't received yet
+        std::vector<Size> shards;
+        pid_t pid;
+        int fd;
+        std::string buffer;
+    };
+
+    namespace {
+
+        // shard number, status (0 if the shard succeeded, 1 if it
+        // threw) and length of the result or error message
+        const Size headerSize = 8 + 1 + 8;
+
+        bool writeAll(int fd, const char* data, Size n) {
+            while (n > 0) {
+                ssize_t written = ::write(fd, data, n);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    return false;
+                data += written;
+                n -= Size(written);
+            }
+            return true;
+        }
+
+        void reap(pid_t pid) {
+            int status;
+            while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        }
+
+    }
+
+    ShardRunner::ShardRunner(Size processes, Size maxRestarts)
+    : processes_(processes), maxRestarts_(maxRestarts), restarts_(0) {}
+
+    std::vector<std::string> ShardRunner::run(Size shards,
+                                              const Shard& shard) {
+        restarts_ = 0;
+        std::vector<std::string> results(shards);
+        if (processes_ == 0) {
+            for (Size i=0; i<shards; ++i)
+                results[i] = shard(i);
+            return results;
+        }
+
+        std::vector<Worker> workers(std::min(processes_, shards));
+        for (Size i=0; i<shards; ++i)
+            workers[i % workers.size()].shards.push_back(i);
+
+        std::string failure;
+        std::vector<std::string> errors;
+        try {
+            for (Size w=0; w<workers.size(); ++w)
+                start(workers[w], shard);
+
+            std::vector<char> chunk(65536);
+            for (;;) {
+                std::vector<pollfd> fds;
+                std::vector<Size> polled;
+                for (Size w=0; w<workers.size(); ++w) {
+                    if (workers[w].fd < 0)
+                        continue;
+                    pollfd p;
+                    p.fd = workers[w].fd;
+                    p.events = POLLIN;
+                    p.revents = 0;
+                    fds.push_back(p);
+                    polled.push_back(w);
+                }
+                if (fds.empty())
+                    break;
+                if (::poll(&fds[0], fds.size(), -1) < 0) {
+                    QL_REQUIRE(errno == EINTR, "poll failed");
+                    continue;
+                }
+
+                for (Size k=0; k<fds.size(); ++k) {
+                    if (fds[k].revents == 0)
+                        continue;
+                    Worker& worker = workers[polled[k]];
+                    ssize_t n = ::read(worker.fd, &chunk[0], chunk.size());
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n > 0) {
+                        worker.buffer.append(&chunk[0], Size(n));
+                        // complete records
+                        while (worker.buffer.size() >= headerSize) {
+                            boost::uint64_t index, length;
+                            boost::uint8_t status;
+                            const char* p = worker.buffer.data();
+                            std::memcpy(&index, p, 8);
+                            std::memcpy(&status, p+8, 1);
+                            std::memcpy(&length, p+9, 8);
+                            if (worker.buffer.size() < headerSize+length)
+                                break;
+                            std::string data(p+headerSize, Size(length));
+                            worker.buffer.erase(0, headerSize+length);
+                            if (status == 0)
+                                results[Size(index)].swap(data);
+                            else
+                                errors.push_back(data);
+                            worker.shards.erase(
+                                std::find(worker.shards.begin(),
+                                          worker.shards.end(),
+                                          Size(index)));
+                        }
+                        continue;
+                    }
+
+                    // the worker is done, or died
+                    ::close(worker.fd);
+                    worker.fd = -1;
+                    reap(worker.pid);
+                    if (worker.shards.empty())
+                        continue;
+                    QL_REQUIRE(++restarts_ <= maxRestarts_,
+                               "too many workers lost ("
+                               << restarts_ << ")");
+                    start(worker, shard);
+                }
+            }
+        } catch (std::exception& e) {
+            failure = e.what();
+        }
+
+        if (!failure.empty()) {
+            for (Size w=0; w<workers.size(); ++w) {
+                if (workers[w].fd < 0)
+                    continue;
+                ::kill(workers[w].pid, SIGKILL);
+                ::close(workers[w].fd);
+                reap(workers[w].pid);
+            }
+            QL_FAIL(failure);
+        }
+        QL_REQUIRE(errors.empty(),
+                   errors.size() << " shard(s) failed: " << errors[0]);
+        return results;
+    }
+
+    void ShardRunner::start(Worker& worker, const Shard& shard) const {
+        int fds[2];
+        QL_REQUIRE(::pipe(fds) == 0, "cannot create pipe for worker");
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            QL_FAIL("cannot start worker process");
+        }
+
+        if (pid == 0) {
+            ::close(fds[0]);
+            for (Size i=0; i<worker.shards.size(); ++i) {
+                boost::uint64_t index = worker.shards[i];
+                boost::uint8_t status = 0;
+                std::string data;
+                try {
+                    data = shard(worker.shards[i]);
+                } catch (std::exception& e) {
+                    status = 1;
+                    data = e.what();
+                } catch (...) {
+                    status = 1;
+                    data = "unknown error";
+                }
+                char header[headerSize];
+                boost::uint64_t length = data.size();
+                std::memcpy(header, &index, 8);
+                std::memcpy(header+8, &status, 1);
+                std::memcpy(header+9, &length, 8);
+                if (!writeAll(fds[1], header, headerSize) ||
+                    !writeAll(fds[1], data.data(), data.size()))
+                    ::_exit(1);
+            }
+            // skips the destructors and exit handlers of the caller
+            ::_exit(0);
+        }
+
+        ::close(fds[1]);
+        worker.pid = pid;
+        worker.fd = fds[0];
+        worker.buffer.clear();
+    }
+
+}
@@ -0,0 +1,77 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file shardrunner.hpp
+    \brief Execution of independent shards in worker processes
+
+    The class is implemented in shardrunner.cpp, which must be
+    compiled into the program.
+*/
+
+#ifndef imt_shard_runner_hpp
+#define imt_shard_runner_hpp
+
+#include <ql/types.hpp>
+#include <boost/function.hpp>
+#include <string>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Runs the shards of a computation in worker processes
+    /*! A computation is split into shards, numbered from 0, whose
+        results depend on their number only; each shard returns its
+        result as a string of bytes, e.g., the state of a mergeable
+        accumulator. The shards are dealt round-robin to worker
+        processes forked from the caller, so that they find the
+        inputs of the computation already in memory, and their
+        results are streamed back to the caller over pipes as soon as
+        they're done.
+
+        A worker that dies before returning all its shards is
+        replaced by a new one computing the missing shards only; the
+        results are the same as if it hadn't died, since shards are
+        deterministic. A shard throwing an exception is not retried;
+        its message is reported once all workers are done.
+
+        As with any use of fork(), the caller should not hold locks
+        that the shards need, and other threads of the caller are not
+        running in the workers.
+    */
+    class ShardRunner {
+      public:
+        typedef boost::function<std::string(Size)> Shard;
+        /*! \param processes    worker processes; 0 to run the shards
+                                in the calling process
+            \param maxRestarts  workers that can be replaced in a run
+                                before it fails
+        */
+        explicit ShardRunner(Size processes, Size maxRestarts = 3);
+        //! returns the results of the shards, in shard order
+        std::vector<std::string> run(Size shards, const Shard& shard);
+        //! workers replaced during the last run
+        Size restarts() const { return restarts_; }
+      private:
+        struct Worker;
+        void start(Worker&, const Shard&) const;
+        Size processes_, maxRestarts_, restarts_;
+    };
+
+}
+
+
+#endif
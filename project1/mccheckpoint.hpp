@@ -0,0 +1,250 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file mccheckpoint.hpp
+    \brief Checkpoint of a Monte Carlo simulation
+*/
+
+#ifndef montecarlo_checkpoint_hpp
+#define montecarlo_checkpoint_hpp
+
+#include "streamingstatistics.hpp"
+#include <boost/cstdint.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace QuantLib {
+
+    //! State of a Monte Carlo simulation
+    /*! The random-number generator is identified by its seed and
+        dimension and positioned by the number of sequences drawn so
+        far; on resumption, the generator is rebuilt and advanced by
+        that many sequences, which costs the random numbers but not
+        the paths or their pricing. Together with the moments of the
+        accumulator, this allows a simulation to be continued so that
+        it yields the same result as an uninterrupted one. The payoff
+        and market data of the simulated option and its importance
+        sampling are recorded as well, so that a checkpoint isn't
+        resumed for a different option or estimator.
+
+        The binary layout is fixed-size and written in the native
+        byte order; checkpoints are meant to be resumed on the same
+        kind of machine.
+    */
+    class McCheckpoint {
+      public:
+        McCheckpoint();
+        //! \name Generator position
+        //@{
+        BigNatural seed;
+        Size dimension;
+        bool antitheticVariate, brownianBridge;
+        Time maturity;
+        Size sequences;
+        //@}
+        //! \name Simulated option
+        //@{
+        Real spot, strike;
+        Integer optionType;
+        Rate riskFreeRate, dividendYield;
+        Volatility volatility;
+        bool importanceSampling;
+        Real importanceSamplingShift;
+        //@}
+        //! \name Accumulator state
+        //@{
+        Size samples;
+        Real weightSum, mean, sumOfSquaredDeviations, min, max;
+        //@}
+        //! writes the checkpoint, atomically replacing the file
+        void save(const std::string& filename) const;
+        //! reads a checkpoint written by save()
+        static McCheckpoint load(const std::string& filename);
+        //! writes the checkpoint to the given stream
+        void write(std::ostream& out) const;
+        //! reads a checkpoint written by write()
+        static McCheckpoint read(std::istream& in);
+        //! whether the file exists and can be opened for reading
+        static bool exists(const std::string& filename);
+    };
+
+    //! \name Accumulator state transfer
+    /*! Only statistics policies with a compact state can be
+        checkpointed; overloads are provided for StreamingStatistics.
+    */
+    //@{
+    template <class S>
+    inline void saveAccumulator(const S&, McCheckpoint&) {
+        QL_FAIL("statistics policy cannot be checkpointed; "
+                "use StreamingStatistics");
+    }
+
+    template <class S>
+    inline void restoreAccumulator(S&, const McCheckpoint&) {
+        QL_FAIL("statistics policy cannot be checkpointed; "
+                "use StreamingStatistics");
+    }
+
+    inline void saveAccumulator(const StreamingStatistics& s,
+                                McCheckpoint& checkpoint) {
+        checkpoint.samples = s.samples();
+        checkpoint.weightSum = s.weightSum();
+        checkpoint.mean = (s.samples() > 0 ? s.mean() : 0.0);
+        checkpoint.sumOfSquaredDeviations = s.sumOfSquaredDeviations();
+        checkpoint.min = s.runningMin();
+        checkpoint.max = s.runningMax();
+    }
+
+    inline void restoreAccumulator(StreamingStatistics& s,
+                                   const McCheckpoint& checkpoint) {
+        s = StreamingStatistics(checkpoint.samples,
+                                checkpoint.weightSum,
+                                checkpoint.mean,
+                                checkpoint.sumOfSquaredDeviations,
+                                checkpoint.min,
+                                checkpoint.max);
+    }
+    //@}
+
+
+    // inline definitions
+
+    namespace detail {
+
+        const char mcCheckpointMagic[4] = { 'Q', 'L', 'M', 'C' };
+        const boost::uint32_t mcCheckpointVersion = 3;
+
+        template <class T>
+        inline void writeRaw(std::ostream& out, T x) {
+            out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+        }
+
+        template <class T>
+        inline T readRaw(std::istream& in) {
+            T x;
+            in.read(reinterpret_cast<char*>(&x), sizeof(T));
+            QL_REQUIRE(in, "truncated checkpoint");
+            return x;
+        }
+
+    }
+
+    inline McCheckpoint::McCheckpoint()
+    : seed(0), dimension(0), antitheticVariate(false), brownianBridge(false),
+      maturity(0.0), sequences(0), spot(0.0), strike(0.0), optionType(0),
+      riskFreeRate(0.0), dividendYield(0.0), volatility(0.0),
+      importanceSampling(false), importanceSamplingShift(0.0), samples(0),
+      weightSum(0.0), mean(0.0), sumOfSquaredDeviations(0.0),
+      min(QL_MAX_REAL), max(QL_MIN_REAL) {}
+
+    inline void McCheckpoint::write(std::ostream& out) const {
+        using namespace detail;
+        out.write(mcCheckpointMagic, sizeof(mcCheckpointMagic));
+        writeRaw<boost::uint32_t>(out, mcCheckpointVersion);
+        writeRaw<boost::uint64_t>(out, seed);
+        writeRaw<boost::uint64_t>(out, dimension);
+        writeRaw<boost::uint8_t>(out, antitheticVariate);
+        writeRaw<boost::uint8_t>(out, brownianBridge);
+        writeRaw<double>(out, maturity);
+        writeRaw<boost::uint64_t>(out, sequences);
+        writeRaw<double>(out, spot);
+        writeRaw<double>(out, strike);
+        writeRaw<boost::int32_t>(out, optionType);
+        writeRaw<double>(out, riskFreeRate);
+        writeRaw<double>(out, dividendYield);
+        writeRaw<double>(out, volatility);
+        writeRaw<boost::uint8_t>(out, importanceSampling);
+        writeRaw<double>(out, importanceSamplingShift);
+        writeRaw<boost::uint64_t>(out, samples);
+        writeRaw<double>(out, weightSum);
+        writeRaw<double>(out, mean);
+        writeRaw<double>(out, sumOfSquaredDeviations);
+        writeRaw<double>(out, min);
+        writeRaw<double>(out, max);
+    }
+
+    inline McCheckpoint McCheckpoint::read(std::istream& in) {
+        using namespace detail;
+        char magic[sizeof(mcCheckpointMagic)];
+        in.read(magic, sizeof(magic));
+        QL_REQUIRE(in && std::equal(magic, magic+sizeof(magic),
+                                    mcCheckpointMagic),
+                   "not a Monte Carlo checkpoint");
+        boost::uint32_t version = readRaw<boost::uint32_t>(in);
+        QL_REQUIRE(version == mcCheckpointVersion,
+                   "unsupported checkpoint version " << version);
+
+        McCheckpoint c;
+        c.seed = BigNatural(readRaw<boost::uint64_t>(in));
+        c.dimension = Size(readRaw<boost::uint64_t>(in));
+        c.antitheticVariate = readRaw<boost::uint8_t>(in) != 0;
+        c.brownianBridge = readRaw<boost::uint8_t>(in) != 0;
+        c.maturity = readRaw<double>(in);
+        c.sequences = Size(readRaw<boost::uint64_t>(in));
+        c.spot = readRaw<double>(in);
+        c.strike = readRaw<double>(in);
+        c.optionType = Integer(readRaw<boost::int32_t>(in));
+        c.riskFreeRate = readRaw<double>(in);
+        c.dividendYield = readRaw<double>(in);
+        c.volatility = readRaw<double>(in);
+        c.importanceSampling = readRaw<boost::uint8_t>(in) != 0;
+        c.importanceSamplingShift = readRaw<double>(in);
+        c.samples = Size(readRaw<boost::uint64_t>(in));
+        c.weightSum = readRaw<double>(in);
+        c.mean = readRaw<double>(in);
+        c.sumOfSquaredDeviations = readRaw<double>(in);
+        c.min = readRaw<double>(in);
+        c.max = readRaw<double>(in);
+        return c;
+    }
+
+    inline void McCheckpoint::save(const std::string& filename) const {
+        std::string tmp = filename + ".tmp";
+        {
+            std::ofstream out(tmp.c_str(),
+                              std::ios::out | std::ios::binary |
+                              std::ios::trunc);
+            QL_REQUIRE(out, "unable to open " << tmp << " for writing");
+            write(out);
+            out.flush();
+            QL_REQUIRE(out, "error while writing " << tmp);
+        }
+        // the previous checkpoint stays valid until the new one is complete
+        QL_REQUIRE(std::rename(tmp.c_str(), filename.c_str()) == 0,
+                   "unable to replace " << filename);
+    }
+
+    inline McCheckpoint McCheckpoint::load(const std::string& filename) {
+        std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+        QL_REQUIRE(in, "unable to open " << filename);
+        try {
+            return read(in);
+        } catch (std::exception& e) {
+            QL_FAIL(filename << ": " << e.what());
+        }
+    }
+
+    inline bool McCheckpoint::exists(const std::string& filename) {
+        std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+        return in.good();
+    }
+
+}
+
+
+#endif
@@ -30,12 +30,69 @@
 #include <ql/processes/blackscholesprocess.hpp>
 #include <ql/termstructures/volatility/equityfx/blackconstantvol.hpp>
 #include <ql/termstructures/volatility/equityfx/blackvariancecurve.hpp>
+#include <ql/math/statistics/incrementalstatistics.hpp>
+#include "mccheckpoint.hpp"
+#include "../common/deadline.hpp"
+#include "../common/instrumentation.hpp"
 
 namespace QuantLib {
 
+    class EuropeanPathGreeks_2;
+
     //! European option pricing engine using Monte Carlo simulation
     /*! \ingroup vanillaengines
 
+        When greeks are requested, delta and vega are estimated
+        pathwise and gamma with a mixed pathwise/likelihood-ratio
+        estimator on the same paths used for the NPV; their error
+        estimates are stored in the additional results as
+        "deltaErrorEstimate", "gammaErrorEstimate" and
+        "vegaErrorEstimate".
+
+        The default statistics policy stores every sample; for large
+        runs, StreamingStatistics (see streamingstatistics.hpp) can be
+        used instead and keeps memory constant.
+
+        If a checkpoint file is given, the state of the simulation is
+        written to it periodically and at the end of the calculation,
+        including when the maximum number of samples is reached
+        before the required tolerance. If the file exists when the
+        calculation starts, the simulation resumes from it and only
+        adds the samples needed to reach the new tolerance or number
+        of samples; the result is the same as that of an uninterrupted
+        run. A checkpoint written for different simulation settings,
+        payoff or market data is refused. Checkpointing requires a
+        non-null seed and StreamingStatistics as statistics policy, and
+        is not available together with greeks.
+
+        Importance sampling shifts the standard normal variate driving
+        the terminal value of each path by a constant and reweights
+        the payoff by the corresponding likelihood ratio; this amounts
+        to a drift in the Brownian increments and is compatible with
+        both antithetic variates and Brownian bridging. Unless given,
+        the shift is chosen so that out-of-the-money options are
+        centered on their strike.
+
+        In anytime mode, the engine is given a wall-clock budget and
+        keeps adding samples while time remains, stopping earlier if
+        the required tolerance or number of samples (if any) is
+        reached. Samples are added in batches sized from the measured
+        cost of the previous ones so that the budget is overrun by at
+        most one small batch; whether the deadline stopped the
+        simulation is stored in the additional results as
+        "deadlineReached".
+
+        With CachedRandom as random-number policy (see
+        mcrandomcache.hpp), the sequences are drawn once for a given
+        seed and number of time steps and replayed by later
+        calculations, which makes bump-and-reprice greeks cheaper and
+        far less noisy.
+
+        When built with IMT_ENABLE_INSTRUMENTATION, the engine traces
+        its setup and sampling batches and reports the time spent in
+        path generation, pricing and statistics, measured on one
+        sample in timingStride and scaled to the whole batch.
+
         \test the correctness of the returned value is tested by
               checking it against analytic results.
     */
@@ -60,9 +117,53 @@ namespace QuantLib {
              Size requiredSamples,
              Real requiredTolerance,
              Size maxSamples,
-             BigNatural seed);
+             BigNatural seed,
+             bool greeks = false,
+             const std::string& checkpointFile = "",
+             bool importanceSampling = false,
+             Real importanceSamplingShift = Null<Real>(),
+             Real deadline = Null<Real>());
+        void calculate() const;
       protected:
         boost::shared_ptr<path_pricer_type> pathPricer() const;
+        //! path generator whose first sequences were already drawn
+        boost::shared_ptr<path_generator_type> resumedPathGenerator(
+                                                  Size skippedSequences) const;
+        //! adds samples to the model, checkpointing if required
+        void addSamples(Size samples) const;
+        //! draws and prices the given number of samples
+        void simulate(Size samples) const;
+        void addSample() const;
+        //! as addSample, timing each phase; used when instrumented
+        void addTimedSample(long long& generation,
+                            long long& pricing,
+                            long long& statistics) const;
+        //! one sample in timingStride is timed
+        static const Size timingStride = 64;
+        void saveCheckpoint() const;
+        //! records the payoff and market data in the checkpoint
+        void recordOption(McCheckpoint& checkpoint) const;
+        //! importance-sampling shift of the option, or 0
+        Real samplingShift() const;
+        /*! adds samples until the deadline or the targets are reached;
+            returns whether the deadline stopped the simulation.
+        */
+        bool addSamplesUntil(const Deadline& deadline,
+                             Size sampleNumber) const;
+        //! samples in the first batch of an anytime simulation
+        static const Size firstDeadlineBatch = 64;
+        //! samples added between two checkpoints
+        static const Size checkpointInterval = 1048576;
+        bool greeks_;
+        std::string checkpointFile_;
+        bool importanceSampling_;
+        Real importanceSamplingShift_;
+        Real deadline_;
+        mutable boost::shared_ptr<EuropeanPathGreeks_2> pathGreeks_;
+        mutable McCheckpoint checkpoint_;
+        mutable boost::shared_ptr<path_generator_type> generator_;
+        mutable boost::shared_ptr<path_pricer_type> pricer_;
+        mutable stats_type accumulator_;
     };
 
     //! Monte Carlo European engine factory
@@ -80,15 +181,47 @@ namespace QuantLib {
         MakeMCEuropeanEngine_2& withMaxSamples(Size samples);
         MakeMCEuropeanEngine_2& withSeed(BigNatural seed);
         MakeMCEuropeanEngine_2& withAntitheticVariate(bool b = true);
+        MakeMCEuropeanEngine_2& withGreeks(bool b = true);
+        MakeMCEuropeanEngine_2& withCheckpointFile(const std::string& file);
+        /*! if no shift is given, it is determined from the strike */
+        MakeMCEuropeanEngine_2& withImportanceSampling(
+                                               Real shift = Null<Real>());
+        //! wall-clock budget, in seconds, for each calculation
+        MakeMCEuropeanEngine_2& withDeadline(Real seconds);
         // conversion to pricing engine
         operator boost::shared_ptr<PricingEngine>() const;
       private:
         boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
-        bool antithetic_;
+        bool antithetic_, greeks_;
         Size steps_, stepsPerYear_, samples_, maxSamples_;
         Real tolerance_;
         bool brownianBridge_;
         BigNatural seed_;
+        std::string checkpointFile_;
+        bool importanceSampling_;
+        Real importanceSamplingShift_;
+        Real deadline_;
+    };
+
+    //! Accumulator for pathwise and likelihood-ratio greeks
+    /*! The estimators assume lognormal terminal values, which is the
+        case for the Black-Scholes process. Under antithetic sampling
+        both paths of a pair are added as separate samples; since the
+        two are usually negatively correlated, the error estimates
+        are then on the conservative side.
+    */
+    class EuropeanPathGreeks_2 {
+      public:
+        void add(Real delta, Real gamma, Real vega) {
+            delta_.add(delta);
+            gamma_.add(gamma);
+            vega_.add(vega);
+        }
+        const IncrementalStatistics& delta() const { return delta_; }
+        const IncrementalStatistics& gamma() const { return gamma_; }
+        const IncrementalStatistics& vega() const { return vega_; }
+      private:
+        IncrementalStatistics delta_, gamma_, vega_;
     };
 
     class EuropeanPathPricer_2 : public PathPricer<Path> {
@@ -96,10 +229,32 @@ namespace QuantLib {
         EuropeanPathPricer_2(Option::Type type,
                              Real strike,
                              DiscountFactor discount);
+        /*! \param drift     log of the forward growth factor
+                              \f$ \ln(F/S_0) \f$ up to maturity
+            \param stdDev    terminal standard deviation
+                              \f$ \sigma\sqrt{T} \f$
+            \param maturity  time to maturity
+            \param greeks    accumulator for the greeks, if any
+            \param shift     importance-sampling shift of the standard
+                              normal variate driving the terminal value
+        */
+        EuropeanPathPricer_2(
+                    Option::Type type,
+                    Real strike,
+                    DiscountFactor discount,
+                    Real drift,
+                    Real stdDev,
+                    Time maturity,
+                    const boost::shared_ptr<EuropeanPathGreeks_2>& greeks,
+                    Real shift = 0.0);
         Real operator()(const Path& path) const;
       private:
         PlainVanillaPayoff payoff_;
         DiscountFactor discount_;
+        Real drift_, stdDev_;
+        Time maturity_;
+        boost::shared_ptr<EuropeanPathGreeks_2> greeks_;
+        Real shift_;
     };
 
 
@@ -116,7 +271,12 @@ namespace QuantLib {
              Size requiredSamples,
              Real requiredTolerance,
              Size maxSamples,
-             BigNatural seed)
+             BigNatural seed,
+             bool greeks,
+             const std::string& checkpointFile,
+             bool importanceSampling,
+             Real importanceSamplingShift,
+             Real deadline)
     : MCVanillaEngine<SingleVariate,RNG,S>(process,
                                            timeSteps,
                                            timeStepsPerYear,
@@ -126,7 +286,410 @@ namespace QuantLib {
                                            requiredSamples,
                                            requiredTolerance,
                                            maxSamples,
-                                           seed) {}
+                                           seed),
+      greeks_(greeks), checkpointFile_(checkpointFile),
+      importanceSampling_(importanceSampling),
+      importanceSamplingShift_(importanceSamplingShift),
+      deadline_(deadline) {
+        QL_REQUIRE(!greeks_ || checkpointFile_.empty(),
+                   "greeks cannot be checkpointed");
+        // a null seed is replaced by one from the clock, and a resumed
+        // simulation would then draw different numbers
+        QL_REQUIRE(checkpointFile_.empty() || seed != 0,
+                   "a non-null seed is required for checkpointing");
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::calculate() const {
+        QL_REQUIRE(this->requiredTolerance_ != Null<Real>() ||
+                   this->requiredSamples_ != Null<Size>() ||
+                   deadline_ != Null<Real>(),
+                   "neither tolerance, number of samples nor deadline set");
+
+        // the budget includes the setup of the simulation
+        boost::shared_ptr<Deadline> deadline;
+        if (deadline_ != Null<Real>())
+            deadline = boost::shared_ptr<Deadline>(new Deadline(deadline_));
+
+        IMT_TRACE_SCOPE("mc.calculate");
+        IMT_TRACE_BEGIN(setupSpan, "mc.setup");
+
+        TimeGrid grid = this->timeGrid();
+        checkpoint_ = McCheckpoint();
+        checkpoint_.seed = this->seed_;
+        checkpoint_.dimension = this->process_->factors()*(grid.size()-1);
+        checkpoint_.antitheticVariate = this->isAntitheticVariate_;
+        checkpoint_.brownianBridge = this->brownianBridge_;
+        checkpoint_.maturity = grid.back();
+        if (!checkpointFile_.empty())
+            recordOption(checkpoint_);
+
+        stats_type accumulator;
+        if (!checkpointFile_.empty()) {
+            // fail early if the statistics policy can't be checkpointed
+            saveAccumulator(accumulator, checkpoint_);
+            if (McCheckpoint::exists(checkpointFile_)) {
+                McCheckpoint previous = McCheckpoint::load(checkpointFile_);
+                QL_REQUIRE(previous.seed == checkpoint_.seed &&
+                           previous.dimension == checkpoint_.dimension &&
+                           previous.antitheticVariate ==
+                                             checkpoint_.antitheticVariate &&
+                           previous.brownianBridge ==
+                                             checkpoint_.brownianBridge,
+                           "checkpoint " << checkpointFile_ << " was written "
+                           "by a simulation with different settings");
+                QL_REQUIRE(std::fabs(previous.maturity-checkpoint_.maturity)
+                                                               <= 1.0e-12,
+                           "checkpoint " << checkpointFile_ << " was written "
+                           "for a different maturity");
+                // otherwise, the new samples would be added to the
+                // moments of another option
+                QL_REQUIRE(previous.spot == checkpoint_.spot &&
+                           previous.strike == checkpoint_.strike &&
+                           previous.optionType == checkpoint_.optionType &&
+                           previous.riskFreeRate ==
+                                               checkpoint_.riskFreeRate &&
+                           previous.dividendYield ==
+                                               checkpoint_.dividendYield &&
+                           previous.volatility == checkpoint_.volatility,
+                           "checkpoint " << checkpointFile_ << " was written "
+                           "for a different option or market data");
+                // nor to those of another estimator
+                QL_REQUIRE(previous.importanceSampling ==
+                                         checkpoint_.importanceSampling &&
+                           previous.importanceSamplingShift ==
+                                         checkpoint_.importanceSamplingShift,
+                           "checkpoint " << checkpointFile_ << " was written "
+                           "with a different importance sampling");
+                restoreAccumulator(accumulator, previous);
+                checkpoint_.sequences = previous.sequences;
+            }
+        }
+
+        // same sampling as MonteCarloModel, which however gives no
+        // access to the accumulator and copies each path; the model is
+        // only built at the end, on the final statistics
+        generator_ = resumedPathGenerator(checkpoint_.sequences);
+        pricer_ = this->pathPricer();
+        accumulator_ = accumulator;
+        IMT_TRACE_END(setupSpan);
+
+        Size sampleNumber = accumulator_.samples();
+        if (deadline) {
+            this->results_.additionalResults["deadlineReached"] =
+                addSamplesUntil(*deadline, sampleNumber);
+        } else if (this->requiredTolerance_ != Null<Real>()) {
+            // same strategy as McSimulation::value
+            const Size minSamples = 1023;
+            Size maxSamples = (this->maxSamples_ != Null<Size>() ?
+                               this->maxSamples_ : Size(QL_MAX_INTEGER));
+            Real tolerance = this->requiredTolerance_;
+            if (sampleNumber < minSamples) {
+                addSamples(minSamples-sampleNumber);
+                sampleNumber = minSamples;
+            }
+            Real error = accumulator_.errorEstimate();
+            while (error > tolerance) {
+                QL_REQUIRE(sampleNumber < maxSamples,
+                           "max number of samples (" << maxSamples
+                           << ") reached, while error (" << error
+                           << ") is still above tolerance ("
+                           << tolerance << ")");
+                // conservative estimate of how many samples are needed
+                Real order = error*error/tolerance/tolerance;
+                Size nextBatch = Size(std::max<Real>(
+                        static_cast<Real>(sampleNumber)*order*0.8
+                                        - static_cast<Real>(sampleNumber),
+                        static_cast<Real>(minSamples)));
+                // do not exceed maxSamples
+                nextBatch = std::min(nextBatch, maxSamples-sampleNumber);
+                sampleNumber += nextBatch;
+                addSamples(nextBatch);
+                error = accumulator_.errorEstimate();
+            }
+        } else {
+            QL_REQUIRE(this->requiredSamples_ >= sampleNumber,
+                       "number of already simulated samples ("
+                       << sampleNumber
+                       << ") greater than requested samples ("
+                       << this->requiredSamples_ << ")");
+            addSamples(this->requiredSamples_-sampleNumber);
+        }
+
+        // the McSimulation interface, e.g., sampleAccumulator() or
+        // value(tolerance), works on the final statistics and goes on
+        // with the same paths
+        this->mcModel_ =
+            boost::shared_ptr<MonteCarloModel<SingleVariate,RNG,S> >(
+                new MonteCarloModel<SingleVariate,RNG,S>(
+                                            generator_, pricer_, accumulator_,
+                                            this->isAntitheticVariate_));
+
+        this->results_.value = accumulator_.mean();
+        if (RNG::allowsErrorEstimate)
+            this->results_.errorEstimate =
+                accumulator_.errorEstimate();
+
+        if (greeks_) {
+            QL_ENSURE(pathGreeks_, "no greeks accumulated");
+            this->results_.delta = pathGreeks_->delta().mean();
+            this->results_.gamma = pathGreeks_->gamma().mean();
+            this->results_.vega = pathGreeks_->vega().mean();
+            if (RNG::allowsErrorEstimate) {
+                this->results_.additionalResults["deltaErrorEstimate"] =
+                    pathGreeks_->delta().errorEstimate();
+                this->results_.additionalResults["gammaErrorEstimate"] =
+                    pathGreeks_->gamma().errorEstimate();
+                this->results_.additionalResults["vegaErrorEstimate"] =
+                    pathGreeks_->vega().errorEstimate();
+            }
+        }
+    }
+
+
+    template <class RNG, class S>
+    const Size MCEuropeanEngine_2<RNG,S>::checkpointInterval;
+
+
+    template <class RNG, class S>
+    inline
+    boost::shared_ptr<typename MCEuropeanEngine_2<RNG,S>::path_generator_type>
+    MCEuropeanEngine_2<RNG,S>::resumedPathGenerator(
+                                          Size skippedSequences) const {
+        Size dimensions = this->process_->factors();
+        TimeGrid grid = this->timeGrid();
+        typename RNG::rsg_type generator =
+            RNG::make_sequence_generator(dimensions*(grid.size()-1),
+                                         this->seed_);
+        // antithetic paths reuse the last sequence, so that each
+        // sample consumed exactly one
+        for (Size i=0; i<skippedSequences; ++i)
+            generator.nextSequence();
+        return boost::shared_ptr<path_generator_type>(
+                   new path_generator_type(this->process_, grid,
+                                           generator, this->brownianBridge_));
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::addSamples(Size samples) const {
+        if (checkpointFile_.empty()) {
+            simulate(samples);
+            checkpoint_.sequences += samples;
+            return;
+        }
+        while (samples > 0) {
+            Size batch = std::min(samples, checkpointInterval);
+            simulate(batch);
+            checkpoint_.sequences += batch;
+            samples -= batch;
+            saveCheckpoint();
+        }
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::simulate(Size samples) const {
+        IMT_TRACE_SCOPE("mc.batch");
+        IMT_COUNT("mc.paths",
+                  (this->isAntitheticVariate_ ? 2 : 1)*samples);
+        // the path generator evolves the process once per step
+        IMT_COUNT("mc.processCalls",
+                  (this->isAntitheticVariate_ ? 2 : 1)*samples*
+                  (generator_->timeGrid().size()-1));
+
+#ifdef IMT_ENABLE_INSTRUMENTATION
+        static InstrumentationTimer& generationTimer =
+            Instrumentation::instance().timer("mc.generation");
+        static InstrumentationTimer& pricingTimer =
+            Instrumentation::instance().timer("mc.pricing");
+        static InstrumentationTimer& statisticsTimer =
+            Instrumentation::instance().timer("mc.statistics");
+        long long generation = 0, pricing = 0, statistics = 0;
+        Size timed = 0;
+        for (Size j=0; j<samples; ++j) {
+            if (j % timingStride == 0) {
+                addTimedSample(generation, pricing, statistics);
+                ++timed;
+            } else {
+                addSample();
+            }
+        }
+        if (timed > 0) {
+            Real scale = Real(samples)/timed;
+            generationTimer.add((long long)(generation*scale), samples);
+            pricingTimer.add((long long)(pricing*scale), samples);
+            statisticsTimer.add((long long)(statistics*scale), samples);
+        }
+#else
+        for (Size j=0; j<samples; ++j)
+            addSample();
+#endif
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::addSample() const {
+        // the generator returns a reference to its current path,
+        // which is overwritten by the antithetic one
+        const typename path_generator_type::sample_type& path =
+            generator_->next();
+        Real price = (*pricer_)(path.value);
+        if (this->isAntitheticVariate_) {
+            const typename path_generator_type::sample_type& antithetic =
+                generator_->antithetic();
+            Real price2 = (*pricer_)(antithetic.value);
+            accumulator_.add((price+price2)/2.0, antithetic.weight);
+        } else {
+            accumulator_.add(price, path.weight);
+        }
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::addTimedSample(
+                                            long long& generation,
+                                            long long& pricing,
+                                            long long& statistics) const {
+        long long t0 = Instrumentation::now();
+        const typename path_generator_type::sample_type& path =
+            generator_->next();
+        long long t1 = Instrumentation::now();
+        Real price = (*pricer_)(path.value);
+        Real weight = path.weight;
+        long long t2 = Instrumentation::now();
+        generation += t1-t0;
+        pricing += t2-t1;
+        if (this->isAntitheticVariate_) {
+            const typename path_generator_type::sample_type& antithetic =
+                generator_->antithetic();
+            long long t3 = Instrumentation::now();
+            Real price2 = (*pricer_)(antithetic.value);
+            t0 = Instrumentation::now();
+            generation += t3-t2;
+            pricing += t0-t3;
+            t2 = t0;
+            price = (price+price2)/2.0;
+            weight = antithetic.weight;
+        }
+        accumulator_.add(price, weight);
+        statistics += Instrumentation::now()-t2;
+    }
+
+
+    template <class RNG, class S>
+    const Size MCEuropeanEngine_2<RNG,S>::timingStride;
+
+
+    template <class RNG, class S>
+    inline bool MCEuropeanEngine_2<RNG,S>::addSamplesUntil(
+                                                 const Deadline& deadline,
+                                                 Size sampleNumber) const {
+        Size target = this->requiredSamples_;
+        if (target == Null<Size>())
+            target = (this->maxSamples_ != Null<Size>() ?
+                      this->maxSamples_ : Size(QL_MAX_INTEGER));
+        Real tolerance = this->requiredTolerance_;
+
+        Size batch = firstDeadlineBatch;
+        Real timePerSample = Null<Real>();
+        while (sampleNumber < target) {
+            if (tolerance != Null<Real>() && sampleNumber > 1 &&
+                accumulator_.errorEstimate()
+                                                             <= tolerance)
+                return false;
+            if (timePerSample != Null<Real>()) {
+                // grow the batches, but only spend half the time left
+                // so that the estimate can be refined before the end
+                Real affordable = 0.5*deadline.remaining()/timePerSample;
+                if (affordable < 1.0)
+                    return true;
+                batch = std::min<Size>(2*batch, Size(affordable));
+            }
+            batch = std::min(batch, target-sampleNumber);
+            Real start = deadline.elapsed();
+            addSamples(batch);
+            sampleNumber += batch;
+            timePerSample = std::max<Real>(deadline.elapsed()-start,
+                                           QL_EPSILON) / batch;
+            if (deadline.expired())
+                return true;
+        }
+        return false;
+    }
+
+
+    template <class RNG, class S>
+    const Size MCEuropeanEngine_2<RNG,S>::firstDeadlineBatch;
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::saveCheckpoint() const {
+        saveAccumulator(accumulator_, checkpoint_);
+        checkpoint_.save(checkpointFile_);
+    }
+
+
+    template <class RNG, class S>
+    inline void MCEuropeanEngine_2<RNG,S>::recordOption(
+                                          McCheckpoint& checkpoint) const {
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                this->arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process =
+            boost::dynamic_pointer_cast<GeneralizedBlackScholesProcess>(
+                this->process_);
+        QL_REQUIRE(process, "Black-Scholes process required");
+
+        Time maturity = checkpoint.maturity;
+        checkpoint.spot = process->x0();
+        checkpoint.strike = payoff->strike();
+        checkpoint.optionType = Integer(payoff->optionType());
+        checkpoint.riskFreeRate = process->riskFreeRate()->zeroRate(
+                                     maturity, Continuous, NoFrequency);
+        checkpoint.dividendYield = process->dividendYield()->zeroRate(
+                                     maturity, Continuous, NoFrequency);
+        checkpoint.volatility = process->blackVolatility()->blackVol(
+                                     maturity, payoff->strike());
+        checkpoint.importanceSampling = importanceSampling_;
+        checkpoint.importanceSamplingShift = samplingShift();
+    }
+
+
+    template <class RNG, class S>
+    inline Real MCEuropeanEngine_2<RNG,S>::samplingShift() const {
+        if (!importanceSampling_)
+            return 0.0;
+        if (importanceSamplingShift_ != Null<Real>())
+            return importanceSamplingShift_;
+
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                this->arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process =
+            boost::dynamic_pointer_cast<GeneralizedBlackScholesProcess>(
+                this->process_);
+        QL_REQUIRE(process, "Black-Scholes process required");
+
+        Time maturity = this->timeGrid().back();
+        Real drift = std::log(process->dividendYield()->discount(maturity) /
+                              process->riskFreeRate()->discount(maturity));
+        Real stdDev = std::sqrt(process->blackVolatility()->blackVariance(
+                                                maturity, payoff->strike()));
+        QL_REQUIRE(stdDev > 0.0,
+                   "positive variance required for importance sampling");
+        // move the center of the terminal distribution onto the
+        // strike if the option is out of the money
+        Real d2 = (std::log(process->x0()/payoff->strike())
+                   + drift - 0.5*stdDev*stdDev) / stdDev;
+        if ((payoff->optionType() == Option::Call && d2 < 0.0) ||
+            (payoff->optionType() == Option::Put && d2 > 0.0))
+            return -d2;
+        return 0.0;
+    }
 
 
     template <class RNG, class S>
@@ -144,22 +707,50 @@ namespace QuantLib {
                 this->process_);
         QL_REQUIRE(process, "Black-Scholes process required");
 
+        Time maturity = this->timeGrid().back();
+        DiscountFactor discount = process->riskFreeRate()->discount(maturity);
+
+        if (!greeks_ && !importanceSampling_)
+            return boost::shared_ptr<
+                       typename MCEuropeanEngine_2<RNG,S>::path_pricer_type>(
+                new EuropeanPathPricer_2(payoff->optionType(),
+                                         payoff->strike(),
+                                         discount));
+
+        // a fresh accumulator for each simulation
+        pathGreeks_.reset();
+        if (greeks_)
+            pathGreeks_ = boost::shared_ptr<EuropeanPathGreeks_2>(
+                                                   new EuropeanPathGreeks_2);
+        Real drift = std::log(process->dividendYield()->discount(maturity) /
+                              discount);
+        Real stdDev = std::sqrt(process->blackVolatility()->blackVariance(
+                                                maturity, payoff->strike()));
+        QL_REQUIRE(stdDev > 0.0,
+                   "positive variance required for greeks "
+                   "or importance sampling");
+
+        Real shift = samplingShift();
+
         return boost::shared_ptr<
                        typename MCEuropeanEngine_2<RNG,S>::path_pricer_type>(
-          new EuropeanPathPricer_2(
-              payoff->optionType(),
-              payoff->strike(),
-              process->riskFreeRate()->discount(this->timeGrid().back())));
+            new EuropeanPathPricer_2(payoff->optionType(),
+                                     payoff->strike(),
+                                     discount,
+                                     drift, stdDev, maturity,
+                                     pathGreeks_, shift));
     }
 
 
     template <class RNG, class S>
     inline MakeMCEuropeanEngine_2<RNG,S>::MakeMCEuropeanEngine_2(
              const boost::shared_ptr<GeneralizedBlackScholesProcess>& process)
-    : process_(process), antithetic_(false),
+    : process_(process), antithetic_(false), greeks_(false),
       steps_(Null<Size>()), stepsPerYear_(Null<Size>()),
       samples_(Null<Size>()), maxSamples_(Null<Size>()),
-      tolerance_(Null<Real>()), brownianBridge_(false), seed_(0) {}
+      tolerance_(Null<Real>()), brownianBridge_(false), seed_(0),
+      importanceSampling_(false), importanceSamplingShift_(Null<Real>()),
+      deadline_(Null<Real>()) {}
 
     template <class RNG, class S>
     inline MakeMCEuropeanEngine_2<RNG,S>&
@@ -224,6 +815,38 @@ namespace QuantLib {
         return *this;
     }
 
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withGreeks(bool b) {
+        greeks_ = b;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withCheckpointFile(const std::string& file) {
+        checkpointFile_ = file;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withImportanceSampling(Real shift) {
+        importanceSampling_ = true;
+        importanceSamplingShift_ = shift;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMCEuropeanEngine_2<RNG,S>&
+    MakeMCEuropeanEngine_2<RNG,S>::withDeadline(Real seconds) {
+        QL_REQUIRE(RNG::allowsErrorEstimate,
+                   "chosen random generator policy "
+                   "does not allow an error estimate");
+        deadline_ = seconds;
+        return *this;
+    }
+
     template <class RNG, class S>
     inline
     MakeMCEuropeanEngine_2<RNG,S>::operator boost::shared_ptr<PricingEngine>()
@@ -240,7 +863,12 @@ namespace QuantLib {
                                       antithetic_,
                                       samples_, tolerance_,
                                       maxSamples_,
-                                      seed_));
+                                      seed_,
+                                      greeks_,
+                                      checkpointFile_,
+                                      importanceSampling_,
+                                      importanceSamplingShift_,
+                                      deadline_));
     }
 
 
@@ -248,14 +876,64 @@ namespace QuantLib {
     inline EuropeanPathPricer_2::EuropeanPathPricer_2(Option::Type type,
                                                       Real strike,
                                                       DiscountFactor discount)
-    : payoff_(type, strike), discount_(discount) {
+    : payoff_(type, strike), discount_(discount),
+      drift_(0.0), stdDev_(0.0), maturity_(0.0), shift_(0.0) {
+        QL_REQUIRE(strike>=0.0,
+                   "strike less than zero not allowed");
+    }
+
+    inline EuropeanPathPricer_2::EuropeanPathPricer_2(
+                    Option::Type type,
+                    Real strike,
+                    DiscountFactor discount,
+                    Real drift,
+                    Real stdDev,
+                    Time maturity,
+                    const boost::shared_ptr<EuropeanPathGreeks_2>& greeks,
+                    Real shift)
+    : payoff_(type, strike), discount_(discount),
+      drift_(drift), stdDev_(stdDev), maturity_(maturity), greeks_(greeks),
+      shift_(shift) {
         QL_REQUIRE(strike>=0.0,
                    "strike less than zero not allowed");
+        QL_REQUIRE(stdDev>0.0,
+                   "positive standard deviation required");
     }
 
     inline Real EuropeanPathPricer_2::operator()(const Path& path) const {
         QL_REQUIRE(path.length() > 0, "the path cannot be empty");
-        return payoff_(path.back()) * discount_;
+        Real sT = path.back();
+        if (!greeks_ && shift_ == 0.0)
+            return payoff_(sT) * discount_;
+
+        // standard normal variate driving the terminal value
+        Real s0 = path.front();
+        Real z = (std::log(sT/s0) - drift_ + 0.5*stdDev_*stdDev_)/stdDev_;
+
+        // likelihood ratio of the shifted variate
+        Real weight = 1.0;
+        if (shift_ != 0.0) {
+            sT *= std::exp(stdDev_*shift_);
+            weight = std::exp(-shift_*z - 0.5*shift_*shift_);
+            z += shift_;
+        }
+        Real value = payoff_(sT) * discount_ * weight;
+
+        if (greeks_) {
+            // the payoff derivative is a signed indicator of moneyness
+            Real phi = 0.0;
+            if (payoff_.optionType() == Option::Call && sT > payoff_.strike())
+                phi = 1.0;
+            else if (payoff_.optionType() == Option::Put &&
+                     sT < payoff_.strike())
+                phi = -1.0;
+            Real w = discount_ * weight * phi * sT;
+            greeks_->add(w/s0,
+                         w/(s0*s0) * (z/stdDev_ - 1.0),
+                         w * std::sqrt(maturity_) * (z - stdDev_));
+        }
+
+        return value;
     }
 
 }
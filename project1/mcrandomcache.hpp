@@ -0,0 +1,313 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file mcrandomcache.hpp
+    \brief Cache of random sequences for common random numbers
+*/
+
+#ifndef mc_random_cache_hpp
+#define mc_random_cache_hpp
+
+#include <ql/math/randomnumbers/rngtraits.hpp>
+#include <ql/patterns/singleton.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/once.hpp>
+#include <map>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Process-wide cache of the sequences drawn by an RNG policy
+    /*! The sequences of each (dimension, seed) pair are drawn once,
+        in blocks of blockSize, and kept read-only so that they can be
+        replayed by any number of generators, on any thread.
+
+        Blocks are only drawn while the memory they take stays within
+        the budget; past the last cached block, a generator goes on
+        with its own copy of the underlying generator, taken at the
+        end of the cache, so that it returns the same sequences
+        without drawing the cached ones again.
+
+        A seed of 0 asks the underlying generator for a random seed;
+        the cache keeps the sequences drawn with it for the whole
+        life of the program.
+    */
+    template <class RNG>
+    class RandomSequenceCache
+        : public Singleton<RandomSequenceCache<RNG> > {
+        friend class Singleton<RandomSequenceCache<RNG> >;
+      public:
+        typedef typename RNG::rsg_type rsg_type;
+        typedef typename rsg_type::sample_type sample_type;
+        //! sequences drawn at a time
+        static const Size blockSize = 4096;
+        struct Block {
+            std::vector<sample_type> sequences;
+        };
+        class Entry;
+
+        /*! unlike Singleton::instance, which it hides, this can be
+            called for the first time from several threads at once.
+        */
+        static RandomSequenceCache<RNG>& instance();
+        //! returns the sequences of the given dimension and seed
+        boost::shared_ptr<Entry> entry(Size dimension, BigNatural seed);
+
+        //! \name Memory
+        //@{
+        //! bytes that the cached blocks may take; 256 MB by default
+        Size memoryBudget() const;
+        /*! blocks already cached are kept if the budget is lowered
+            below the memory they take; further ones are not drawn.
+        */
+        void setMemoryBudget(Size bytes);
+        //! bytes taken by the cached blocks
+        Size memoryUsed() const;
+        /*! removes all entries; generators using them keep their
+            blocks until they're destroyed.
+        */
+        void clear();
+        //@}
+      private:
+        RandomSequenceCache();
+        static void initialize();
+        bool reserve(Size bytes);
+        typedef std::map<std::pair<Size,BigNatural>,
+                         boost::shared_ptr<Entry> > EntryMap;
+        mutable boost::mutex mutex_;
+        EntryMap entries_;
+        Size budget_, used_;
+    };
+
+
+    //! Sequences of a given dimension and seed
+    template <class RNG>
+    class RandomSequenceCache<RNG>::Entry : private boost::noncopyable {
+      public:
+        Entry(RandomSequenceCache<RNG>& cache, Size dimension,
+              BigNatural seed);
+        Size dimension() const { return dimension_; }
+        /*! returns the k-th block, drawing it if it's the first one
+            not yet cached and the budget allows. Otherwise, the
+            block is null and \c spill is set to a generator about to
+            return its first sequence; the blocks must be requested
+            in order.
+        */
+        boost::shared_ptr<const Block> block(
+                               Size k, boost::optional<rsg_type>& spill);
+      private:
+        RandomSequenceCache<RNG>& cache_;
+        Size dimension_;
+        boost::mutex mutex_;
+        std::vector<boost::shared_ptr<const Block> > blocks_;
+        // positioned after the last cached block
+        rsg_type frontier_;
+    };
+
+
+    //! Sequence generator replaying the sequences of a cache entry
+    /*! Copies taken before the first sequence is drawn replay the
+        same sequences independently, as copies of the underlying
+        generator would.
+    */
+    template <class RNG>
+    class CachedSequenceGenerator {
+      public:
+        typedef typename RandomSequenceCache<RNG>::rsg_type rsg_type;
+        typedef typename RandomSequenceCache<RNG>::sample_type sample_type;
+        typedef typename RandomSequenceCache<RNG>::Block Block;
+        explicit CachedSequenceGenerator(
+            const boost::shared_ptr<typename RandomSequenceCache<RNG>::Entry>&
+                                                                     entry);
+        const sample_type& nextSequence() const;
+        const sample_type& lastSequence() const;
+        Size dimension() const { return entry_->dimension(); }
+      private:
+        boost::shared_ptr<typename RandomSequenceCache<RNG>::Entry> entry_;
+        mutable boost::shared_ptr<const Block> block_;
+        mutable Size index_;
+        mutable boost::optional<rsg_type> spill_;
+    };
+
+
+    //! Random-number policy replaying cached sequences
+    /*! Can be used in place of the wrapped policy as the \c RNG
+        parameter of MCEuropeanEngine_2 and MakeMCEuropeanEngine_2.
+        Each calculation then replays the same sequences for a given
+        seed and number of time steps instead of drawing them, so
+        that bumping the spot, the volatility or the rates and
+        pricing again gives common-random-number sensitivities, and
+        only the first calculation pays for the generation.
+
+        The results are the same as with the wrapped policy; the
+        memory budget is set on RandomSequenceCache<RNG>.
+    */
+    template <class RNG = PseudoRandom>
+    struct CachedRandom {
+        typedef CachedSequenceGenerator<RNG> rsg_type;
+        enum { allowsErrorEstimate = RNG::allowsErrorEstimate };
+        static rsg_type make_sequence_generator(Size dimension,
+                                                BigNatural seed) {
+            return rsg_type(RandomSequenceCache<RNG>::instance().entry(
+                                                         dimension, seed));
+        }
+    };
+
+
+    // template definitions
+
+    template <class RNG>
+    const Size RandomSequenceCache<RNG>::blockSize;
+
+    template <class RNG>
+    RandomSequenceCache<RNG>::RandomSequenceCache()
+    : budget_(256*1024*1024), used_(0) {}
+
+    template <class RNG>
+    RandomSequenceCache<RNG>& RandomSequenceCache<RNG>::instance() {
+        // the flag is initialized statically, before any thread runs
+        static boost::once_flag once = BOOST_ONCE_INIT;
+        boost::call_once(&RandomSequenceCache<RNG>::initialize, once);
+        return Singleton<RandomSequenceCache<RNG> >::instance();
+    }
+
+    template <class RNG>
+    void RandomSequenceCache<RNG>::initialize() {
+        Singleton<RandomSequenceCache<RNG> >::instance();
+    }
+
+    template <class RNG>
+    boost::shared_ptr<typename RandomSequenceCache<RNG>::Entry>
+    RandomSequenceCache<RNG>::entry(Size dimension, BigNatural seed) {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        boost::shared_ptr<Entry>& entry =
+            entries_[std::make_pair(dimension, seed)];
+        if (!entry)
+            entry = boost::shared_ptr<Entry>(
+                                      new Entry(*this, dimension, seed));
+        return entry;
+    }
+
+    template <class RNG>
+    Size RandomSequenceCache<RNG>::memoryBudget() const {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        return budget_;
+    }
+
+    template <class RNG>
+    void RandomSequenceCache<RNG>::setMemoryBudget(Size bytes) {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        budget_ = bytes;
+    }
+
+    template <class RNG>
+    Size RandomSequenceCache<RNG>::memoryUsed() const {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        return used_;
+    }
+
+    template <class RNG>
+    void RandomSequenceCache<RNG>::clear() {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        entries_.clear();
+        used_ = 0;
+    }
+
+    template <class RNG>
+    bool RandomSequenceCache<RNG>::reserve(Size bytes) {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        if (used_ + bytes > budget_)
+            return false;
+        used_ += bytes;
+        return true;
+    }
+
+
+    template <class RNG>
+    RandomSequenceCache<RNG>::Entry::Entry(RandomSequenceCache<RNG>& cache,
+                                           Size dimension,
+                                           BigNatural seed)
+    : cache_(cache), dimension_(dimension),
+      frontier_(RNG::make_sequence_generator(dimension, seed)) {}
+
+    template <class RNG>
+    boost::shared_ptr<const typename RandomSequenceCache<RNG>::Block>
+    RandomSequenceCache<RNG>::Entry::block(
+                               Size k, boost::optional<rsg_type>& spill) {
+        // other generators wanting the same block wait for it
+        // rather than drawing it again
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        if (k < blocks_.size())
+            return blocks_[k];
+        QL_REQUIRE(k == blocks_.size(),
+                   "block " << k << " requested before block "
+                   << blocks_.size());
+        Size bytes = blockSize*(sizeof(sample_type) +
+                                dimension_*sizeof(Real));
+        if (!cache_.reserve(bytes)) {
+            spill = frontier_;
+            return boost::shared_ptr<const Block>();
+        }
+        boost::shared_ptr<Block> block(new Block);
+        block->sequences.reserve(blockSize);
+        for (Size i=0; i<blockSize; ++i)
+            block->sequences.push_back(frontier_.nextSequence());
+        blocks_.push_back(block);
+        return block;
+    }
+
+
+    template <class RNG>
+    CachedSequenceGenerator<RNG>::CachedSequenceGenerator(
+            const boost::shared_ptr<typename RandomSequenceCache<RNG>::Entry>&
+                                                                      entry)
+    : entry_(entry), index_(0) {}
+
+    template <class RNG>
+    const typename CachedSequenceGenerator<RNG>::sample_type&
+    CachedSequenceGenerator<RNG>::nextSequence() const {
+        if (spill_)
+            return spill_->nextSequence();
+        const Size blockSize = RandomSequenceCache<RNG>::blockSize;
+        Size i = index_ % blockSize;
+        if (i == 0) {
+            block_ = entry_->block(index_/blockSize, spill_);
+            if (!block_)
+                return spill_->nextSequence();
+        }
+        ++index_;
+        return block_->sequences[i];
+    }
+
+    template <class RNG>
+    const typename CachedSequenceGenerator<RNG>::sample_type&
+    CachedSequenceGenerator<RNG>::lastSequence() const {
+        if (spill_)
+            return spill_->lastSequence();
+        QL_REQUIRE(index_ > 0, "no sequence drawn yet");
+        const Size blockSize = RandomSequenceCache<RNG>::blockSize;
+        return block_->sequences[(index_-1) % blockSize];
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,203 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file mcshardedengine.hpp
+    \brief Monte Carlo European engine sharded across processes
+*/
+
+#ifndef montecarlo_sharded_european_engine_hpp
+#define montecarlo_sharded_european_engine_hpp
+
+#include "mceuropeanengine.hpp"
+#include "../common/shardrunner.hpp"
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <sstream>
+
+namespace QuantLib {
+
+    //! European Monte Carlo engine running its samples in shards
+    /*! The required samples are split into shards of shardSamples,
+        the last one possibly shorter; a single remaining sample is
+        added to the previous shard instead, as the error estimate of
+        a shard needs two samples. Shard \f$ k \f$ is simulated
+        by an MCEuropeanEngine_2 with its own seed, derived from the
+        given one and from \f$ k \f$ by shardSeed(), so that the
+        shards draw from disjoint streams. The shards are run by a
+        ShardRunner, in worker processes or in the calling one, and
+        their StreamingStatistics are merged in shard order.
+
+        The result thus depends on the seed, the number of samples
+        and the shard size, but not on the number of processes nor
+        on workers lost and restarted during the calculation; in
+        particular, it is exactly the one obtained when the shards
+        are run in the calling process. It is not the same as that
+        of a single MCEuropeanEngine_2 with the same seed, whose
+        samples come from one stream.
+
+        The number of shards and of restarted workers are stored in
+        the additional results as "shards" and "workerRestarts".
+
+        \ingroup vanillaengines
+    */
+    template <class RNG = PseudoRandom>
+    class ShardedMCEuropeanEngine_2 : public VanillaOption::engine {
+      public:
+        /*! \param seed          must be non-null, so that all
+                                 processes draw the same numbers
+            \param processes     worker processes; 0 to run the
+                                 shards in the calling process
+            \param maxRestarts   workers that can be lost in a
+                                 calculation before it fails
+        */
+        ShardedMCEuropeanEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps,
+             bool brownianBridge,
+             bool antitheticVariate,
+             Size requiredSamples,
+             BigNatural seed,
+             Size shardSamples = 65536,
+             Size processes = 0,
+             Size maxRestarts = 3);
+        void calculate() const;
+        //! seed of the given shard
+        static BigNatural shardSeed(BigNatural seed, Size shard);
+      protected:
+        //! number of shards
+        Size shards() const;
+        //! samples simulated by the given shard
+        Size samples(Size shard) const;
+        //! simulates the given shard and returns its statistics
+        std::string simulateShard(Size shard) const;
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Size timeSteps_;
+        bool brownianBridge_, antitheticVariate_;
+        Size requiredSamples_;
+        BigNatural seed_;
+        Size shardSamples_, processes_, maxRestarts_;
+    };
+
+
+    // template definitions
+
+    template <class RNG>
+    ShardedMCEuropeanEngine_2<RNG>::ShardedMCEuropeanEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps,
+             bool brownianBridge,
+             bool antitheticVariate,
+             Size requiredSamples,
+             BigNatural seed,
+             Size shardSamples,
+             Size processes,
+             Size maxRestarts)
+    : process_(process), timeSteps_(timeSteps),
+      brownianBridge_(brownianBridge), antitheticVariate_(antitheticVariate),
+      requiredSamples_(requiredSamples), seed_(seed),
+      shardSamples_(shardSamples), processes_(processes),
+      maxRestarts_(maxRestarts) {
+        QL_REQUIRE(timeSteps > 0, "at least one time step required");
+        QL_REQUIRE(requiredSamples >= 2, "at least two samples required");
+        QL_REQUIRE(shardSamples >= 2,
+                   "at least two samples per shard required");
+        QL_REQUIRE(seed != 0, "a non-null seed is required");
+        registerWith(process_);
+    }
+
+    template <class RNG>
+    BigNatural ShardedMCEuropeanEngine_2<RNG>::shardSeed(BigNatural seed,
+                                                         Size shard) {
+        // SplitMix64 of the seed moved by the shard number
+        boost::uint64_t z = boost::uint64_t(seed) +
+            boost::uint64_t(shard+1) * 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        // a null seed would be replaced by a random one
+        return z != 0 ? BigNatural(z) : BigNatural(1);
+    }
+
+    template <class RNG>
+    Size ShardedMCEuropeanEngine_2<RNG>::shards() const {
+        // as (requiredSamples_ + shardSamples_ - 1)/shardSamples_, but
+        // a single remaining sample goes to the previous shard
+        return (requiredSamples_ - 2)/shardSamples_ + 1;
+    }
+
+    template <class RNG>
+    Size ShardedMCEuropeanEngine_2<RNG>::samples(Size shard) const {
+        return shard+1 < shards() ? shardSamples_ :
+                                    requiredSamples_ - shard*shardSamples_;
+    }
+
+    template <class RNG>
+    void ShardedMCEuropeanEngine_2<RNG>::calculate() const {
+
+        IMT_TRACE_SCOPE("mc.sharded.calculate");
+
+        Size shards = this->shards();
+        ShardRunner runner(processes_, maxRestarts_);
+        std::vector<std::string> states = runner.run(
+            shards,
+            boost::bind(&ShardedMCEuropeanEngine_2<RNG>::simulateShard,
+                        this, _1));
+
+        StreamingStatistics statistics;
+        for (Size i=0; i<shards; ++i) {
+            std::istringstream in(states[i]);
+            StreamingStatistics shard;
+            restoreAccumulator(shard, McCheckpoint::read(in));
+            statistics.merge(shard);
+        }
+
+        results_.value = statistics.mean();
+        if (RNG::allowsErrorEstimate)
+            results_.errorEstimate = statistics.errorEstimate();
+        results_.additionalResults["shards"] = shards;
+        results_.additionalResults["workerRestarts"] = runner.restarts();
+    }
+
+    template <class RNG>
+    std::string ShardedMCEuropeanEngine_2<RNG>::simulateShard(
+                                                       Size shard) const {
+        Size samples = this->samples(shard);
+        QL_ENSURE(samples >= 2, "shard " << shard << " has " << samples
+                  << " samples; at least two required");
+        MCEuropeanEngine_2<RNG, StreamingStatistics> engine(
+                                             process_, timeSteps_,
+                                             Null<Size>(), brownianBridge_,
+                                             antitheticVariate_, samples,
+                                             Null<Real>(), Null<Size>(),
+                                             shardSeed(seed_, shard));
+        VanillaOption::arguments* arguments =
+            dynamic_cast<VanillaOption::arguments*>(engine.getArguments());
+        QL_REQUIRE(arguments, "wrong argument type");
+        *arguments = arguments_;
+        engine.calculate();
+
+        McCheckpoint checkpoint;
+        saveAccumulator(engine.sampleAccumulator(), checkpoint);
+        std::ostringstream out(std::ios::out | std::ios::binary);
+        checkpoint.write(out);
+        return out.str();
+    }
+
+}
+
+
+#endif
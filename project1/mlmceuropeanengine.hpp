@@ -0,0 +1,342 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file mlmceuropeanengine.hpp
+    \brief Multilevel Monte Carlo European option engine
+*/
+
+#ifndef multilevel_montecarlo_european_engine_hpp
+#define multilevel_montecarlo_european_engine_hpp
+
+#include "mceuropeanengine.hpp"
+#include <ql/methods/montecarlo/path.hpp>
+#include <ql/math/randomnumbers/rngtraits.hpp>
+
+namespace QuantLib {
+
+    //! European option pricing engine using multilevel Monte Carlo
+    /*! Level \f$ l \f$ simulates paths with \f$ n_0 2^l \f$ steps and
+        estimates the expected difference between the payoff on a
+        fine path and on the coarse path with half the steps driven
+        by the same Brownian increments (pairwise sums of the fine
+        ones). The estimator is the sum of the level means, as in
+        M.B. Giles, "Multilevel Monte Carlo path simulation",
+        Operations Research 56(3), 2008.
+
+        The number of levels and the samples per level are chosen
+        from on-the-fly variance estimates so that the root mean
+        square error of the result is below the required tolerance;
+        for Euler-type discretizations this takes
+        \f$ O(\epsilon^{-2}) \f$ work instead of the
+        \f$ O(\epsilon^{-3}) \f$ of a single-level simulation.
+
+        The path pricer is obtained from a virtual method, so that
+        derived engines can price path-dependent payoffs on the same
+        coupled paths.
+
+        The statistical error is returned as error estimate; the
+        number of levels and the samples per level are stored in the
+        additional results as "levels" and "samplesPerLevel".
+
+        \ingroup vanillaengines
+    */
+    template <class RNG = PseudoRandom, class S = Statistics>
+    class MLMCEuropeanEngine_2 : public VanillaOption::engine {
+      public:
+        typedef typename RNG::rsg_type rsg_type;
+        typedef S stats_type;
+        MLMCEuropeanEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size coarsestSteps,
+             Real requiredTolerance,
+             Size warmupSamples,
+             Size maxLevels,
+             BigNatural seed);
+        void calculate() const;
+      protected:
+        virtual boost::shared_ptr<PathPricer<Path> > pathPricer(
+                                                       Time maturity) const;
+        //! adds samples of the correction at the given level
+        void addSamples(Size level,
+                        Size samples,
+                        Time maturity,
+                        rsg_type& generator,
+                        const PathPricer<Path>& pricer,
+                        stats_type& stats) const;
+        Size fineSteps(Size level) const { return coarsestSteps_ << level; }
+        //! relative cost of a sample at the given level
+        Real cost(Size level) const {
+            return fineSteps(level) * (level == 0 ? 1.0 : 1.5);
+        }
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Size coarsestSteps_;
+        Real requiredTolerance_;
+        Size warmupSamples_, maxLevels_;
+        BigNatural seed_;
+    };
+
+
+    //! Multilevel Monte Carlo European engine factory
+    template <class RNG = PseudoRandom, class S = Statistics>
+    class MakeMLMCEuropeanEngine_2 {
+      public:
+        MakeMLMCEuropeanEngine_2(
+                    const boost::shared_ptr<GeneralizedBlackScholesProcess>&);
+        // named parameters
+        MakeMLMCEuropeanEngine_2& withSteps(Size coarsestSteps);
+        //! tolerance on the root mean square error
+        MakeMLMCEuropeanEngine_2& withAbsoluteTolerance(Real tolerance);
+        MakeMLMCEuropeanEngine_2& withWarmupSamples(Size samples);
+        MakeMLMCEuropeanEngine_2& withMaxLevels(Size levels);
+        MakeMLMCEuropeanEngine_2& withSeed(BigNatural seed);
+        // conversion to pricing engine
+        operator boost::shared_ptr<PricingEngine>() const;
+      private:
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Size steps_, warmupSamples_, maxLevels_;
+        Real tolerance_;
+        BigNatural seed_;
+    };
+
+
+    // inline definitions
+
+    template <class RNG, class S>
+    inline MLMCEuropeanEngine_2<RNG,S>::MLMCEuropeanEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size coarsestSteps,
+             Real requiredTolerance,
+             Size warmupSamples,
+             Size maxLevels,
+             BigNatural seed)
+    : process_(process), coarsestSteps_(coarsestSteps),
+      requiredTolerance_(requiredTolerance), warmupSamples_(warmupSamples),
+      maxLevels_(maxLevels), seed_(seed) {
+        QL_REQUIRE(coarsestSteps_ > 0, "no time steps given");
+        QL_REQUIRE(requiredTolerance_ > 0.0,
+                   "positive tolerance required");
+        QL_REQUIRE(warmupSamples_ > 1,
+                   "at least 2 warm-up samples required");
+        QL_REQUIRE(maxLevels_ >= 3 && maxLevels_ < 8*sizeof(Size),
+                   "number of levels (" << maxLevels_
+                   << ") out of range");
+        registerWith(process_);
+    }
+
+
+    template <class RNG, class S>
+    inline void MLMCEuropeanEngine_2<RNG,S>::calculate() const {
+
+        Time maturity = process_->time(arguments_.exercise->lastDate());
+        boost::shared_ptr<PathPricer<Path> > pricer = pathPricer(maturity);
+
+        // weak and strong orders assumed for the discretization
+        const Real alpha = 1.0, beta = 1.0;
+        const Real epsilon = requiredTolerance_;
+
+        std::vector<stats_type> stats;
+        std::vector<rsg_type> generators;
+        std::vector<Size> extraSamples;
+        for (Size l=0; l<3; ++l) {
+            stats.push_back(stats_type());
+            generators.push_back(RNG::make_sequence_generator(
+                                  fineSteps(l), seed_ == 0 ? 0 : seed_+l));
+            extraSamples.push_back(warmupSamples_);
+        }
+
+        bool done = false;
+        while (!done) {
+            for (Size l=0; l<stats.size(); ++l) {
+                if (extraSamples[l] > 0)
+                    addSamples(l, extraSamples[l], maturity,
+                               generators[l], *pricer, stats[l]);
+            }
+
+            // variances; levels without enough samples extrapolate
+            Size levels = stats.size();
+            std::vector<Real> variances(levels);
+            Real sumOfRoots = 0.0;
+            for (Size l=0; l<levels; ++l) {
+                if (stats[l].samples() > 1)
+                    variances[l] = stats[l].variance();
+                else
+                    variances[l] = variances[l-1]/std::pow(2.0, beta);
+                sumOfRoots += std::sqrt(variances[l]*cost(l));
+            }
+
+            // optimal samples split the variance budget epsilon^2/2
+            bool converged = true;
+            for (Size l=0; l<levels; ++l) {
+                Size optimal = Size(std::ceil(
+                    2.0/(epsilon*epsilon)
+                    * std::sqrt(variances[l]/cost(l)) * sumOfRoots));
+                Size current = stats[l].samples();
+                extraSamples[l] = optimal > current ? optimal-current : 0;
+                if (extraSamples[l] > 0)
+                    converged = false;
+            }
+
+            if (converged) {
+                // estimate the remaining bias from the finest levels
+                Size L = levels-1;
+                Real bias = std::max(std::fabs(stats[L].mean()),
+                                     std::fabs(stats[L-1].mean())
+                                                 / std::pow(2.0, alpha))
+                    / (std::pow(2.0, alpha) - 1.0);
+                if (bias > epsilon/M_SQRT2) {
+                    QL_REQUIRE(levels < maxLevels_,
+                               "max number of levels (" << maxLevels_
+                               << ") reached, while estimated bias ("
+                               << bias << ") is still above tolerance ("
+                               << epsilon/M_SQRT2 << ")");
+                    stats.push_back(stats_type());
+                    generators.push_back(RNG::make_sequence_generator(
+                        fineSteps(levels), seed_ == 0 ? 0 : seed_+levels));
+                    extraSamples.push_back(warmupSamples_);
+                } else {
+                    done = true;
+                }
+            }
+        }
+
+        Real value = 0.0, variance = 0.0;
+        std::vector<Size> samplesPerLevel(stats.size());
+        for (Size l=0; l<stats.size(); ++l) {
+            value += stats[l].mean();
+            variance += stats[l].variance()/stats[l].samples();
+            samplesPerLevel[l] = stats[l].samples();
+        }
+        results_.value = value;
+        if (RNG::allowsErrorEstimate)
+            results_.errorEstimate = std::sqrt(variance);
+        results_.additionalResults["levels"] = stats.size();
+        results_.additionalResults["samplesPerLevel"] = samplesPerLevel;
+    }
+
+
+    template <class RNG, class S>
+    inline void MLMCEuropeanEngine_2<RNG,S>::addSamples(
+                                             Size level,
+                                             Size samples,
+                                             Time maturity,
+                                             rsg_type& generator,
+                                             const PathPricer<Path>& pricer,
+                                             stats_type& stats) const {
+        Size n = fineSteps(level);
+        Time dt = maturity/n;
+        Real x0 = process_->x0();
+        Path fine(TimeGrid(maturity, n));
+        Path coarse(TimeGrid(maturity, std::max<Size>(n/2, 1)));
+        fine.front() = coarse.front() = x0;
+
+        for (Size j=0; j<samples; ++j) {
+            const std::vector<Real>& z = generator.nextSequence().value;
+            for (Size k=0; k<n; ++k)
+                fine[k+1] = process_->evolve(k*dt, fine[k], dt, z[k]);
+            Real y = pricer(fine);
+            if (level > 0) {
+                // coarse increments are the sums of two fine ones
+                for (Size k=0; k<n/2; ++k)
+                    coarse[k+1] = process_->evolve(
+                                 2*k*dt, coarse[k], 2*dt,
+                                 (z[2*k]+z[2*k+1])/M_SQRT2);
+                y -= pricer(coarse);
+            }
+            stats.add(y);
+        }
+    }
+
+
+    template <class RNG, class S>
+    inline boost::shared_ptr<PathPricer<Path> >
+    MLMCEuropeanEngine_2<RNG,S>::pathPricer(Time maturity) const {
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                this->arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+
+        return boost::shared_ptr<PathPricer<Path> >(
+            new EuropeanPathPricer_2(
+                payoff->optionType(),
+                payoff->strike(),
+                process_->riskFreeRate()->discount(maturity)));
+    }
+
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>::MakeMLMCEuropeanEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process)
+    : process_(process), steps_(Null<Size>()), warmupSamples_(1000),
+      maxLevels_(10), tolerance_(Null<Real>()), seed_(0) {}
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withSteps(Size steps) {
+        steps_ = steps;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withAbsoluteTolerance(Real tolerance) {
+        QL_REQUIRE(RNG::allowsErrorEstimate,
+                   "chosen random generator policy "
+                   "does not allow an error estimate");
+        tolerance_ = tolerance;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withWarmupSamples(Size samples) {
+        warmupSamples_ = samples;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withMaxLevels(Size levels) {
+        maxLevels_ = levels;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline MakeMLMCEuropeanEngine_2<RNG,S>&
+    MakeMLMCEuropeanEngine_2<RNG,S>::withSeed(BigNatural seed) {
+        seed_ = seed;
+        return *this;
+    }
+
+    template <class RNG, class S>
+    inline
+    MakeMLMCEuropeanEngine_2<RNG,S>::operator
+    boost::shared_ptr<PricingEngine>() const {
+        QL_REQUIRE(steps_ != Null<Size>(), "number of steps not given");
+        QL_REQUIRE(tolerance_ != Null<Real>(), "tolerance not given");
+        return boost::shared_ptr<PricingEngine>(new
+            MLMCEuropeanEngine_2<RNG,S>(process_,
+                                        steps_,
+                                        tolerance_,
+                                        warmupSamples_,
+                                        maxLevels_,
+                                        seed_));
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,109 @@
+
+#include "mceuropeanengine.hpp"
+#include "zigguratrng.hpp"
+#include <ql/quantlib.hpp>
+#include <iostream>
+#include <iomanip>
+#include <ctime>
+
+using namespace QuantLib;
+
+namespace {
+
+    // normals per second drawn from the sequence generator of a policy
+    template <class RNG>
+    Real sequenceThroughput(Size dimension, Size sequences) {
+        typename RNG::rsg_type generator =
+            RNG::make_sequence_generator(dimension, 42);
+        Real sum = 0.0;
+        std::clock_t start = std::clock();
+        for (Size i=0; i<sequences; ++i)
+            sum += generator.nextSequence().value[0];
+        Real elapsed = Real(std::clock() - start)/CLOCKS_PER_SEC;
+        // keep the loop from being optimized away
+        if (sum == 42.0)
+            std::cout << "";
+        return dimension*sequences/elapsed;
+    }
+
+    template <class RNG>
+    void priceWith(const std::string& name,
+                   VanillaOption& option,
+                   const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                                                                    process,
+                   Size steps, Size samples) {
+        option.setPricingEngine(MakeMCEuropeanEngine_2<RNG>(process)
+                                .withSteps(steps)
+                                .withSamples(samples)
+                                .withSeed(42));
+        std::clock_t start = std::clock();
+        Real npv = option.NPV();
+        Real elapsed = Real(std::clock() - start)/CLOCKS_PER_SEC;
+        std::cout << std::setw(16) << std::left << name
+                  << "NPV: " << std::setw(12) << npv
+                  << "error: " << std::setw(12) << option.errorEstimate()
+                  << "time: " << elapsed << " s" << std::endl;
+    }
+
+}
+
+int main() {
+
+    try {
+
+        Size dimension = 100, sequences = 200000;
+        Real mt = sequenceThroughput<PseudoRandom>(dimension, sequences);
+        Real zig = sequenceThroughput<ZigguratRandom>(dimension, sequences);
+
+        std::cout << "Gaussian deviates per second" << std::endl;
+        std::cout << "PseudoRandom:   " << mt/1.0e6 << " M" << std::endl;
+        std::cout << "ZigguratRandom: " << zig/1.0e6 << " M" << std::endl;
+        std::cout << "speed-up:       " << zig/mt << std::endl;
+        std::cout << std::endl;
+
+        Date today(6, January, 2017);
+        Settings::instance().evaluationDate() = today;
+        DayCounter dayCounter = Actual365Fixed();
+        Calendar calendar = TARGET();
+
+        Handle<Quote> underlying(
+            boost::shared_ptr<Quote>(new SimpleQuote(100.0)));
+        Handle<YieldTermStructure> riskFree(
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(today, 0.03, dayCounter)));
+        Handle<YieldTermStructure> dividends(
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(today, 0.0, dayCounter)));
+        Handle<BlackVolTermStructure> volatility(
+            boost::shared_ptr<BlackVolTermStructure>(
+                new BlackConstantVol(today, calendar, 0.20, dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process(
+            new BlackScholesMertonProcess(underlying, dividends,
+                                          riskFree, volatility));
+
+        VanillaOption option(
+            boost::shared_ptr<StrikedTypePayoff>(
+                new PlainVanillaPayoff(Option::Call, 110.0)),
+            boost::shared_ptr<Exercise>(
+                new EuropeanExercise(Date(5, February, 2018))));
+
+        option.setPricingEngine(boost::shared_ptr<PricingEngine>(
+                                      new AnalyticEuropeanEngine(process)));
+        std::cout << "Analytic NPV:   " << option.NPV() << std::endl;
+
+        Size steps = 50, samples = 100000;
+        priceWith<PseudoRandom>("PseudoRandom", option, process,
+                                steps, samples);
+        priceWith<ZigguratRandom>("ZigguratRandom", option, process,
+                                  steps, samples);
+
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
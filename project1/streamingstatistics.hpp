@@ -0,0 +1,365 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file streamingstatistics.hpp
+    \brief Constant-memory, mergeable statistics accumulator
+*/
+
+#ifndef streaming_statistics_hpp
+#define streaming_statistics_hpp
+
+#include <ql/errors.hpp>
+#include <ql/types.hpp>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+namespace QuantLib {
+
+    //! P-square estimator of a single quantile
+    /*! The quantile is tracked with five markers as in R. Jain and
+        I. Chlamtac, "The P-square algorithm for dynamic calculation
+        of quantiles and histograms without storing observations",
+        Communications of the ACM 28(10), 1985. Memory does not grow
+        with the number of observations. Sample weights are ignored.
+    */
+    class P2Quantile {
+      public:
+        explicit P2Quantile(Real p = 0.5);
+        Real probability() const { return p_; }
+        Size samples() const { return count_; }
+        //! current estimate of the quantile
+        Real value() const;
+        void add(Real x);
+        void reset();
+      private:
+        Real parabolic(Size i, Real d) const;
+        Real linear(Size i, Integer d) const;
+        Real p_;
+        Size count_;
+        Real q_[5], desired_[5], increment_[5];
+        Integer n_[5];
+    };
+
+
+    //! Statistics tool with constant memory and exact merging
+    /*! Mean and variance are updated on the fly with West's weighted
+        version of Welford's algorithm, so that no sample is stored
+        and adding a sample costs O(1) regardless of how many were
+        added before. Two accumulators can be merged exactly with the
+        pairwise formulas of Chan, Golub and LeVeque, which allows
+        partial results from different threads or processes to be
+        reduced into the statistics of the whole sample.
+
+        The class provides the interface required of the statistics
+        policy of the Monte Carlo framework and can therefore be used
+        as the \c S parameter of MCEuropeanEngine_2.
+
+        Quantiles are not available unless explicitly tracked by
+        means of trackPercentile(); in that case they are estimated
+        with the P-square algorithm and cannot be merged.
+    */
+    class StreamingStatistics {
+      public:
+        typedef Real value_type;
+        StreamingStatistics();
+        /*! builds an accumulator from its raw state, as returned by
+            the corresponding inspectors; used for checkpointing.
+        */
+        StreamingStatistics(Size samples,
+                            Real weightSum,
+                            Real mean,
+                            Real sumOfSquaredDeviations,
+                            Real min,
+                            Real max);
+        //! \name Inspectors
+        //@{
+        //! number of samples collected
+        Size samples() const { return samples_; }
+        //! sum of data weights
+        Real weightSum() const { return weightSum_; }
+        /*! returns the mean, defined as
+            \f[ \langle x \rangle = \frac{\sum w_i x_i}{\sum w_i}. \f]
+        */
+        Real mean() const;
+        /*! returns the variance, defined as
+            \f[ \frac{N}{N-1} \left\langle \left(
+                x-\langle x \rangle \right)^2 \right\rangle. \f]
+        */
+        Real variance() const;
+        //! returns the standard deviation
+        Real standardDeviation() const { return std::sqrt(variance()); }
+        //! returns the error estimate on the mean value
+        Real errorEstimate() const;
+        //! returns the minimum sample value
+        Real min() const;
+        //! returns the maximum sample value
+        Real max() const;
+        /*! returns the P-square estimate of the given percentile,
+            which must have been tracked with trackPercentile()
+            before any sample was added.
+        */
+        Real percentile(Real p) const;
+        //@}
+
+        //! \name Raw state
+        //@{
+        //! weighted sum of squared deviations from the mean
+        Real sumOfSquaredDeviations() const { return m2_; }
+        //! running minimum; QL_MAX_REAL for an empty set
+        Real runningMin() const { return min_; }
+        //! running maximum; QL_MIN_REAL for an empty set
+        Real runningMax() const { return max_; }
+        //@}
+
+        //! \name Modifiers
+        //@{
+        //! adds a datum to the set, possibly with a weight
+        void add(Real value, Real weight = 1.0);
+        //! adds a sequence of data to the set, with default weight
+        template <class DataIterator>
+        void addSequence(DataIterator begin, DataIterator end) {
+            for (; begin != end; ++begin)
+                add(*begin);
+        }
+        //! adds a sequence of data to the set, each with its weight
+        template <class DataIterator, class WeightIterator>
+        void addSequence(DataIterator begin, DataIterator end,
+                         WeightIterator wbegin) {
+            for (; begin != end; ++begin, ++wbegin)
+                add(*begin, *wbegin);
+        }
+        /*! adds the samples collected by another accumulator; the
+            result is the same, up to rounding, as if they had been
+            added to this one.
+        */
+        void merge(const StreamingStatistics& other);
+        //! starts tracking the given percentile
+        void trackPercentile(Real p);
+        //! resets the data to a null set
+        void reset();
+        //@}
+      private:
+        Size samples_;
+        Real weightSum_, mean_, m2_, min_, max_;
+        std::vector<P2Quantile> quantiles_;
+    };
+
+
+    // inline definitions
+
+    inline P2Quantile::P2Quantile(Real p) : p_(p) {
+        QL_REQUIRE(p > 0.0 && p < 1.0,
+                   "percentile (" << p << ") must be in (0.0, 1.0)");
+        reset();
+    }
+
+    inline void P2Quantile::reset() {
+        count_ = 0;
+        for (Size i=0; i<5; ++i) {
+            q_[i] = 0.0;
+            n_[i] = Integer(i);
+        }
+        desired_[0] = 0.0;
+        desired_[1] = 2.0*p_;
+        desired_[2] = 4.0*p_;
+        desired_[3] = 2.0 + 2.0*p_;
+        desired_[4] = 4.0;
+        increment_[0] = 0.0;
+        increment_[1] = p_/2.0;
+        increment_[2] = p_;
+        increment_[3] = (1.0+p_)/2.0;
+        increment_[4] = 1.0;
+    }
+
+    inline Real P2Quantile::value() const {
+        QL_REQUIRE(count_ > 0, "empty sample set");
+        if (count_ >= 5)
+            return q_[2];
+        // not enough samples for the markers: use the sorted data
+        Real sorted[5];
+        std::copy(q_, q_+count_, sorted);
+        std::sort(sorted, sorted+count_);
+        Size k = Size(std::ceil(p_*count_)) - 1;
+        return sorted[std::min(k, count_-1)];
+    }
+
+    inline Real P2Quantile::parabolic(Size i, Real d) const {
+        return q_[i] + d/(n_[i+1]-n_[i-1]) *
+            ((n_[i]-n_[i-1]+d)*(q_[i+1]-q_[i])/(n_[i+1]-n_[i]) +
+             (n_[i+1]-n_[i]-d)*(q_[i]-q_[i-1])/(n_[i]-n_[i-1]));
+    }
+
+    inline Real P2Quantile::linear(Size i, Integer d) const {
+        return q_[i] + d*(q_[i+d]-q_[i])/(n_[i+d]-n_[i]);
+    }
+
+    inline void P2Quantile::add(Real x) {
+        if (count_ < 5) {
+            q_[count_++] = x;
+            if (count_ == 5)
+                std::sort(q_, q_+5);
+            return;
+        }
+        ++count_;
+
+        // find the cell containing x, extending the extremes if needed
+        Size k;
+        if (x < q_[0]) {
+            q_[0] = x;
+            k = 0;
+        } else if (x >= q_[4]) {
+            q_[4] = x;
+            k = 3;
+        } else {
+            k = 0;
+            while (x >= q_[k+1])
+                ++k;
+        }
+        for (Size i=k+1; i<5; ++i)
+            ++n_[i];
+        for (Size i=0; i<5; ++i)
+            desired_[i] += increment_[i];
+
+        // adjust the heights of the middle markers
+        for (Size i=1; i<4; ++i) {
+            Real d = desired_[i] - n_[i];
+            if ((d >= 1.0 && n_[i+1]-n_[i] > 1) ||
+                (d <= -1.0 && n_[i-1]-n_[i] < -1)) {
+                Integer s = (d > 0.0 ? 1 : -1);
+                Real q = parabolic(i, s);
+                if (q_[i-1] < q && q < q_[i+1])
+                    q_[i] = q;
+                else
+                    q_[i] = linear(i, s);
+                n_[i] += s;
+            }
+        }
+    }
+
+
+    inline StreamingStatistics::StreamingStatistics() {
+        reset();
+    }
+
+    inline StreamingStatistics::StreamingStatistics(
+                                             Size samples,
+                                             Real weightSum,
+                                             Real mean,
+                                             Real sumOfSquaredDeviations,
+                                             Real min,
+                                             Real max)
+    : samples_(samples), weightSum_(weightSum), mean_(mean),
+      m2_(sumOfSquaredDeviations), min_(min), max_(max) {
+        QL_REQUIRE(weightSum >= 0.0, "negative weight sum given");
+        QL_REQUIRE(sumOfSquaredDeviations >= 0.0,
+                   "negative sum of squared deviations given");
+    }
+
+    inline void StreamingStatistics::reset() {
+        samples_ = 0;
+        weightSum_ = mean_ = m2_ = 0.0;
+        min_ = QL_MAX_REAL;
+        max_ = QL_MIN_REAL;
+        for (Size i=0; i<quantiles_.size(); ++i)
+            quantiles_[i].reset();
+    }
+
+    inline Real StreamingStatistics::mean() const {
+        QL_REQUIRE(weightSum_ > 0.0, "sampleWeight_= 0, unsufficient");
+        return mean_;
+    }
+
+    inline Real StreamingStatistics::variance() const {
+        QL_REQUIRE(weightSum_ > 0.0, "sampleWeight_= 0, unsufficient");
+        QL_REQUIRE(samples_ > 1, "sample number <= 1, unsufficient");
+        Real n = static_cast<Real>(samples_);
+        return std::max<Real>(n/(n-1.0) * m2_/weightSum_, 0.0);
+    }
+
+    inline Real StreamingStatistics::errorEstimate() const {
+        return std::sqrt(variance()/samples_);
+    }
+
+    inline Real StreamingStatistics::min() const {
+        QL_REQUIRE(samples_ > 0, "empty sample set");
+        return min_;
+    }
+
+    inline Real StreamingStatistics::max() const {
+        QL_REQUIRE(samples_ > 0, "empty sample set");
+        return max_;
+    }
+
+    inline Real StreamingStatistics::percentile(Real p) const {
+        for (Size i=0; i<quantiles_.size(); ++i) {
+            if (quantiles_[i].probability() == p)
+                return quantiles_[i].value();
+        }
+        QL_FAIL("percentile " << p << " not tracked");
+    }
+
+    inline void StreamingStatistics::add(Real value, Real weight) {
+        QL_REQUIRE(weight >= 0.0,
+                   "negative weight (" << weight << ") not allowed");
+        ++samples_;
+        Real newWeightSum = weightSum_ + weight;
+        if (newWeightSum > 0.0) {
+            Real delta = value - mean_;
+            Real r = delta * weight / newWeightSum;
+            mean_ += r;
+            m2_ += weightSum_ * delta * r;
+        }
+        weightSum_ = newWeightSum;
+        min_ = std::min(value, min_);
+        max_ = std::max(value, max_);
+        for (Size i=0; i<quantiles_.size(); ++i)
+            quantiles_[i].add(value);
+    }
+
+    inline void StreamingStatistics::merge(const StreamingStatistics& other) {
+        QL_REQUIRE(quantiles_.empty() && other.quantiles_.empty(),
+                   "percentile estimates cannot be merged");
+        if (other.samples_ == 0)
+            return;
+        Real newWeightSum = weightSum_ + other.weightSum_;
+        if (newWeightSum > 0.0) {
+            Real delta = other.mean_ - mean_;
+            mean_ += delta * other.weightSum_ / newWeightSum;
+            m2_ += other.m2_ +
+                delta * delta * weightSum_ * other.weightSum_ / newWeightSum;
+        }
+        weightSum_ = newWeightSum;
+        samples_ += other.samples_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    inline void StreamingStatistics::trackPercentile(Real p) {
+        QL_REQUIRE(samples_ == 0,
+                   "percentiles must be tracked before adding samples");
+        for (Size i=0; i<quantiles_.size(); ++i) {
+            if (quantiles_[i].probability() == p)
+                return;
+        }
+        quantiles_.push_back(P2Quantile(p));
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,261 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file zigguratrng.hpp
+    \brief Ziggurat Gaussian random-number generator and policy
+*/
+
+#ifndef ziggurat_rng_hpp
+#define ziggurat_rng_hpp
+
+#include <ql/methods/montecarlo/sample.hpp>
+#include <ql/math/randomnumbers/seedgenerator.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+#include <cmath>
+
+namespace QuantLib {
+
+    //! xoshiro256** 64-bit uniform random-number generator
+    /*! D. Blackman and S. Vigna, "Scrambled linear pseudorandom number
+        generators", ACM Transactions on Mathematical Software 47(4),
+        2021. The period is \f$ 2^{256}-1 \f$; jump() advances the
+        state by \f$ 2^{128} \f$ draws, which provides non-overlapping
+        substreams for parallel simulations.
+    */
+    class Xoshiro256StarStarRng {
+      public:
+        /*! if the given seed is 0, a random seed will be chosen
+            based on clock(). The seed is expanded into the 256-bit
+            state with SplitMix64.
+        */
+        explicit Xoshiro256StarStarRng(BigNatural seed = 0);
+        //! returns a 64-bit random integer
+        boost::uint64_t nextInt64() const {
+            const boost::uint64_t result = rotl(s_[1]*5, 7) * 9;
+            const boost::uint64_t t = s_[1] << 17;
+            s_[2] ^= s_[0];
+            s_[3] ^= s_[1];
+            s_[1] ^= s_[2];
+            s_[0] ^= s_[3];
+            s_[2] ^= t;
+            s_[3] = rotl(s_[3], 45);
+            return result;
+        }
+        //! returns a uniform sample in [0,1) with 53 random bits
+        Real nextReal() const {
+            return (nextInt64() >> 11) * (1.0/9007199254740992.0);
+        }
+        //! advances the state by \f$ 2^{128} \f$ draws
+        void jump();
+      private:
+        static boost::uint64_t rotl(boost::uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+        mutable boost::uint64_t s_[4];
+    };
+
+
+    //! Gaussian random-number generator based on the Ziggurat method
+    /*! The 128-layer Ziggurat of J.A. Doornik, "An improved Ziggurat
+        method to generate normal random samples", 2005, drawing the
+        layer and the abscissa from disjoint bits of a single 64-bit
+        xoshiro256** output. About 98.8% of the draws are accepted
+        in the first test, which costs one multiplication and one
+        comparison.
+    */
+    class ZigguratGaussianRng {
+      public:
+        typedef Sample<Real> sample_type;
+        /*! \param seed       seed of the underlying uniform generator
+            \param substream  index of the non-overlapping substream
+        */
+        explicit ZigguratGaussianRng(BigNatural seed = 0,
+                                     Size substream = 0);
+        //! returns a sample with Gaussian deviate
+        sample_type next() const { return sample_type(nextReal(), 1.0); }
+        //! returns a standard normal deviate
+        Real nextReal() const;
+      private:
+        struct Tables {
+            Tables();
+            Real x[129], ratio[128];
+        };
+        static const Tables& tables();
+        Real tail(bool negative) const;
+        Xoshiro256StarStarRng uniform_;
+    };
+
+
+    //! Gaussian random-sequence generator based on the Ziggurat method
+    class ZigguratGaussianRsg {
+      public:
+        typedef Sample<std::vector<Real> > sample_type;
+        explicit ZigguratGaussianRsg(Size dimensionality,
+                                     BigNatural seed = 0,
+                                     Size substream = 0);
+        const sample_type& nextSequence() const;
+        const sample_type& lastSequence() const { return sequence_; }
+        Size dimension() const { return dimensionality_; }
+      private:
+        Size dimensionality_;
+        ZigguratGaussianRng rng_;
+        mutable sample_type sequence_;
+    };
+
+
+    //! Ziggurat-based random-number policy for Monte Carlo engines
+    /*! Can be used in place of PseudoRandom as the \c RNG parameter
+        of MCEuropeanEngine_2 and MakeMCEuropeanEngine_2. Parallel
+        simulations should use distinct substreams of the same seed,
+        as returned by make_substream_generator().
+    */
+    struct ZigguratRandom {
+        typedef ZigguratGaussianRng rng_type;
+        typedef ZigguratGaussianRsg rsg_type;
+        enum { allowsErrorEstimate = 1 };
+        static rsg_type make_sequence_generator(Size dimension,
+                                                BigNatural seed) {
+            return rsg_type(dimension, seed);
+        }
+        static rsg_type make_substream_generator(Size dimension,
+                                                 BigNatural seed,
+                                                 Size substream) {
+            return rsg_type(dimension, seed, substream);
+        }
+    };
+
+
+    // inline definitions
+
+    inline Xoshiro256StarStarRng::Xoshiro256StarStarRng(BigNatural seed) {
+        boost::uint64_t x =
+            (seed != 0 ? seed : SeedGenerator::instance().get());
+        for (Size i=0; i<4; ++i) {
+            // SplitMix64
+            boost::uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            s_[i] = z ^ (z >> 31);
+        }
+    }
+
+    inline void Xoshiro256StarStarRng::jump() {
+        static const boost::uint64_t polynomial[4] = {
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+            0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+        };
+        boost::uint64_t s[4] = { 0, 0, 0, 0 };
+        for (Size i=0; i<4; ++i) {
+            for (int b=0; b<64; ++b) {
+                if (polynomial[i] & (boost::uint64_t(1) << b)) {
+                    s[0] ^= s_[0];
+                    s[1] ^= s_[1];
+                    s[2] ^= s_[2];
+                    s[3] ^= s_[3];
+                }
+                nextInt64();
+            }
+        }
+        for (Size i=0; i<4; ++i)
+            s_[i] = s[i];
+    }
+
+
+    inline ZigguratGaussianRng::Tables::Tables() {
+        // rightmost layer edge and common area of the 128 layers
+        const Real r = 3.442619855899;
+        const Real v = 9.91256303526217e-3;
+        Real f = std::exp(-0.5*r*r);
+        x[0] = v/f;       // the base layer includes the tail
+        x[1] = r;
+        x[128] = 0.0;
+        for (Size i=2; i<128; ++i) {
+            x[i] = std::sqrt(-2.0*std::log(v/x[i-1] + f));
+            f = std::exp(-0.5*x[i]*x[i]);
+        }
+        for (Size i=0; i<128; ++i)
+            ratio[i] = x[i+1]/x[i];
+    }
+
+    inline const ZigguratGaussianRng::Tables& ZigguratGaussianRng::tables() {
+        static const Tables t;
+        return t;
+    }
+
+    inline ZigguratGaussianRng::ZigguratGaussianRng(BigNatural seed,
+                                                    Size substream)
+    : uniform_(seed) {
+        for (Size i=0; i<substream; ++i)
+            uniform_.jump();
+        // make sure the tables are built before the first draw
+        tables();
+    }
+
+    inline Real ZigguratGaussianRng::tail(bool negative) const {
+        // Marsaglia's method for the tail beyond r
+        const Real r = tables().x[1];
+        Real x, y;
+        do {
+            x = std::log(1.0 - uniform_.nextReal()) / r;
+            y = std::log(1.0 - uniform_.nextReal());
+        } while (-2.0*y < x*x);
+        return negative ? x - r : r - x;
+    }
+
+    inline Real ZigguratGaussianRng::nextReal() const {
+        const Tables& t = tables();
+        for (;;) {
+            boost::uint64_t bits = uniform_.nextInt64();
+            Size i = Size(bits & 0x7F);
+            Real u = 2.0*((bits >> 11) * (1.0/9007199254740992.0)) - 1.0;
+            // inside the rectangle
+            if (std::fabs(u) < t.ratio[i])
+                return u * t.x[i];
+            // base layer: sample from the tail
+            if (i == 0)
+                return tail(u < 0.0);
+            // wedge between the rectangle and the density
+            Real x = u * t.x[i];
+            Real f0 = std::exp(-0.5*(t.x[i]*t.x[i] - x*x));
+            Real f1 = std::exp(-0.5*(t.x[i+1]*t.x[i+1] - x*x));
+            if (f1 + uniform_.nextReal()*(f0 - f1) < 1.0)
+                return x;
+        }
+    }
+
+
+    inline ZigguratGaussianRsg::ZigguratGaussianRsg(Size dimensionality,
+                                                    BigNatural seed,
+                                                    Size substream)
+    : dimensionality_(dimensionality), rng_(seed, substream),
+      sequence_(std::vector<Real>(dimensionality), 1.0) {
+        QL_REQUIRE(dimensionality > 0,
+                   "dimensionality must be greater than 0");
+    }
+
+    inline const ZigguratGaussianRsg::sample_type&
+    ZigguratGaussianRsg::nextSequence() const {
+        for (Size i=0; i<dimensionality_; ++i)
+            sequence_.value[i] = rng_.nextReal();
+        return sequence_;
+    }
+
+}
+
+
+#endif
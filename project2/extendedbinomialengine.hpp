@@ -0,0 +1,149 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file extendedbinomialengine.hpp
+    \brief Binomial engine for time-dependent trees
+*/
+
+#ifndef extended_binomial_engine_hpp
+#define extended_binomial_engine_hpp
+
+#include "extendedbsmlattice.hpp"
+#include <ql/pricingengines/vanilla/discretizedvanillaoption.hpp>
+#include <ql/pricingengines/greeks.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include "../common/instrumentation.hpp"
+
+namespace QuantLib {
+
+    //! Pricing engine for vanilla options on time-dependent trees
+    /*! Unlike BinomialVanillaEngine, which flattens the curves at
+        maturity, the tree is built on the given process, so that the
+        ExtendedBinomialTree_2 classes follow its term structures, and
+        each step is discounted on the actual risk-free curve (see
+        ExtendedBlackScholesLattice_2). The per-step quantities are
+        tabulated once per calculation.
+
+        The number of steps is the one of the tree, which for
+        ExtendedLeisenReimer_2 and ExtendedJoshi4_2 is made odd.
+        Greeks are estimated from the nodes at the first two steps.
+
+        \ingroup vanillaengines
+    */
+    template <class T>
+    class ExtendedBinomialVanillaEngine_2 : public VanillaOption::engine {
+      public:
+        ExtendedBinomialVanillaEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps)
+        : process_(process), timeSteps_(timeSteps) {
+            QL_REQUIRE(timeSteps >= 2,
+                       "at least 2 time steps required, "
+                       << timeSteps << " provided");
+            registerWith(process_);
+        }
+        void calculate() const;
+      private:
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Size timeSteps_;
+    };
+
+
+    // template definitions
+
+    template <class T>
+    void ExtendedBinomialVanillaEngine_2<T>::calculate() const {
+
+        IMT_TRACE_SCOPE("binomial.calculate");
+
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+        QL_REQUIRE(process_->x0() > 0.0,
+                   "negative or null underlying given");
+
+        Time maturity = process_->time(arguments_.exercise->lastDate());
+
+        IMT_TRACE_BEGIN(treeSpan, "binomial.tree");
+        boost::shared_ptr<T> tree(new T(process_, maturity, timeSteps_,
+                                        payoff->strike()));
+        Size steps = tree->columns()-1;
+        TimeGrid grid(maturity, steps);
+
+        boost::shared_ptr<ExtendedBlackScholesLattice_2<T> > lattice(
+            new ExtendedBlackScholesLattice_2<T>(tree,
+                                                 process_->riskFreeRate(),
+                                                 maturity, steps));
+        IMT_TRACE_END(treeSpan);
+
+        IMT_TRACE_BEGIN(initializeSpan, "binomial.initialize");
+        DiscretizedVanillaOption option(arguments_, *process_, grid);
+
+        option.initialize(lattice, maturity);
+        IMT_TRACE_END(initializeSpan);
+        // nodes evaluated by the rollback: step i has i+1 of them
+        IMT_COUNT("binomial.nodes", steps*(steps+1)/2);
+
+        // as in BinomialVanillaEngine, see J.C.Hull, "Options, Futures
+        // and other derivatives", 6th edition, pp 397/398
+        IMT_TRACE_BEGIN(rollback2Span, "binomial.rollback.grid2");
+        option.rollback(grid[2]);
+        IMT_TRACE_END(rollback2Span);
+        Array va2(option.values());
+        QL_ENSURE(va2.size() == 3, "Expect 3 nodes in grid at second step");
+        Real p2u = va2[2]; // up
+        Real p2m = va2[1]; // mid
+        Real p2d = va2[0]; // down (low)
+        Real s2u = lattice->underlying(2, 2); // up price
+        Real s2m = lattice->underlying(2, 1); // middle price
+        Real s2d = lattice->underlying(2, 0); // down (low) price
+
+        // calculate gamma by taking the first derivate of the two deltas
+        Real delta2u = (p2u - p2m)/(s2u-s2m);
+        Real delta2d = (p2m-p2d)/(s2m-s2d);
+        Real gamma = (delta2u - delta2d) / ((s2u-s2d)/2);
+
+        IMT_TRACE_BEGIN(rollback1Span, "binomial.rollback.grid1");
+        option.rollback(grid[1]);
+        IMT_TRACE_END(rollback1Span);
+        Array va(option.values());
+        QL_ENSURE(va.size() == 2, "Expect 2 nodes in grid at first step");
+        Real p1u = va[1];
+        Real p1d = va[0];
+        Real s1u = lattice->underlying(1, 1); // up (high) price
+        Real s1d = lattice->underlying(1, 0); // down (low) price
+
+        Real delta = (p1u - p1d) / (s1u - s1d);
+
+        IMT_TRACE_BEGIN(rollback0Span, "binomial.rollback.0");
+        option.rollback(0.0);
+        IMT_TRACE_END(rollback0Span);
+        Real p0 = option.presentValue();
+
+        results_.value = p0;
+        results_.delta = delta;
+        results_.gamma = gamma;
+        results_.theta = blackScholesTheta(process_,
+                                           results_.value,
+                                           results_.delta,
+                                           results_.gamma);
+    }
+
+}
+
+
+#endif
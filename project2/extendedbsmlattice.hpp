@@ -0,0 +1,118 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file extendedbsmlattice.hpp
+    \brief Black-Scholes lattice for time-dependent binomial trees
+*/
+
+#ifndef extended_bsm_lattice_hpp
+#define extended_bsm_lattice_hpp
+
+#include <ql/methods/lattices/lattice1d.hpp>
+#include <ql/methods/lattices/lattice.hpp>
+#include <ql/termstructures/yieldtermstructure.hpp>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Black-Scholes lattice on a time-dependent binomial tree
+    /*! Each step i is discounted with the forward discount factor
+        between its time and the next one on the given curve, and the
+        probabilities of the tree are taken to depend on the step
+        only, as in the ExtendedBinomialTree_2 classes.
+
+        The discount factors, the probabilities and the nodes are
+        tabulated once when the lattice is built, so that the rollback
+        makes no call to the tree or to the curve. The nodes are
+        assumed to be geometrically spaced at each step, which is the
+        case for all the trees in this project; each step is stored as
+        its lowest node and the ratio between consecutive ones.
+    */
+    template <class T>
+    class ExtendedBlackScholesLattice_2
+        : public TreeLattice1D<ExtendedBlackScholesLattice_2<T> > {
+      public:
+        typedef T tree_type;
+        ExtendedBlackScholesLattice_2(
+                            const boost::shared_ptr<T>& tree,
+                            const Handle<YieldTermStructure>& riskFreeRate,
+                            Time end,
+                            Size steps);
+
+        Size size(Size i) const { return tree_->size(i); }
+        DiscountFactor discount(Size i, Size) const {
+            return discounts_[i];
+        }
+        void stepback(Size i, const Array& values, Array& newValues) const {
+            const Real pd = downProbabilities_[i],
+                       pu = upProbabilities_[i];
+            const DiscountFactor discount = discounts_[i];
+            for (Size j=0; j<size(i); j++)
+                newValues[j] = (pd*values[j] + pu*values[j+1])*discount;
+        }
+        Real underlying(Size i, Size index) const {
+            return lowest_[i]*std::pow(ratios_[i], Real(index));
+        }
+        Size descendant(Size i, Size index, Size branch) const {
+            return tree_->descendant(i, index, branch);
+        }
+        Real probability(Size i, Size, Size branch) const {
+            return branch == 1 ? upProbabilities_[i] :
+                                 downProbabilities_[i];
+        }
+      protected:
+        boost::shared_ptr<T> tree_;
+        std::vector<DiscountFactor> discounts_;
+        std::vector<Real> upProbabilities_, downProbabilities_;
+        std::vector<Real> lowest_, ratios_;
+    };
+
+
+    // template definitions
+
+    template <class T>
+    ExtendedBlackScholesLattice_2<T>::ExtendedBlackScholesLattice_2(
+                            const boost::shared_ptr<T>& tree,
+                            const Handle<YieldTermStructure>& riskFreeRate,
+                            Time end,
+                            Size steps)
+    : TreeLattice1D<ExtendedBlackScholesLattice_2<T> >(TimeGrid(end, steps),
+                                                       T::branches),
+      tree_(tree), discounts_(steps), upProbabilities_(steps),
+      downProbabilities_(steps), lowest_(steps+1), ratios_(steps+1) {
+        QL_REQUIRE(tree->columns() >= steps+1,
+                   "tree with " << tree->columns()-1 << " steps given; "
+                   "at least " << steps << " required");
+        const TimeGrid& grid = this->timeGrid();
+        DiscountFactor previous = riskFreeRate->discount(grid[0]);
+        for (Size i=0; i<steps; ++i) {
+            DiscountFactor next = riskFreeRate->discount(grid[i+1]);
+            discounts_[i] = next/previous;
+            previous = next;
+            upProbabilities_[i] = tree->probability(i, 0, 1);
+            downProbabilities_[i] = tree->probability(i, 0, 0);
+        }
+        for (Size i=0; i<=steps; ++i) {
+            lowest_[i] = tree->underlying(i, 0);
+            ratios_[i] = i > 0 ? tree->underlying(i, 1)/lowest_[i] : 1.0;
+        }
+    }
+
+}
+
+
+#endif
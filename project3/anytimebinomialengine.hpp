@@ -0,0 +1,124 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file anytimebinomialengine.hpp
+    \brief Deadline-bounded binomial option engine
+*/
+
+#ifndef anytime_binomial_engine_hpp
+#define anytime_binomial_engine_hpp
+
+#include "binomialengine.hpp"
+#include "../common/deadline.hpp"
+
+namespace QuantLib {
+
+    //! Binomial engine refining its tree within a wall-clock budget
+    /*! The option is priced with BinomialVanillaEngine_2 on trees of
+        increasing size, doubling the number of steps as long as the
+        next tree, whose cost is predicted from the last one as
+        growing with the square of the steps, can be completed before
+        the deadline. The first tree is always built, so that the
+        budget is overrun at most by its cost.
+
+        The results are those of the largest tree; the difference
+        from the previous one is returned as error estimate. The
+        number of steps used is stored in the additional results as
+        "timeSteps", and whether the deadline stopped the refinement
+        as "deadlineReached".
+
+        \ingroup vanillaengines
+    */
+    template <class T>
+    class AnytimeBinomialVanillaEngine_2 : public VanillaOption::engine {
+      public:
+        /*! \param deadline      wall-clock budget in seconds
+            \param minTimeSteps  steps of the first tree
+            \param maxTimeSteps  steps beyond which no refinement is made
+        */
+        AnytimeBinomialVanillaEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Real deadline,
+             Size minTimeSteps = 50,
+             Size maxTimeSteps = Null<Size>())
+        : process_(process), deadline_(deadline),
+          minTimeSteps_(minTimeSteps), maxTimeSteps_(maxTimeSteps) {
+            QL_REQUIRE(deadline > 0.0,
+                       "positive deadline required, "
+                       << deadline << " provided");
+            QL_REQUIRE(minTimeSteps >= 2,
+                       "at least 2 time steps required, "
+                       << minTimeSteps << " provided");
+            registerWith(process_);
+        }
+        void calculate() const;
+      private:
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Real deadline_;
+        Size minTimeSteps_, maxTimeSteps_;
+    };
+
+
+    // template definitions
+
+    template <class T>
+    void AnytimeBinomialVanillaEngine_2<T>::calculate() const {
+
+        Deadline deadline(deadline_);
+
+        Size steps = minTimeSteps_;
+        Real previousValue = Null<Real>();
+        bool deadlineReached = false;
+        for (;;) {
+            BinomialVanillaEngine_2<T> engine(process_, steps);
+            VanillaOption::arguments* arguments =
+                dynamic_cast<VanillaOption::arguments*>(
+                                                    engine.getArguments());
+            QL_REQUIRE(arguments, "wrong argument type");
+            *arguments = arguments_;
+
+            Real start = deadline.elapsed();
+            engine.calculate();
+            Real cost = deadline.elapsed() - start;
+
+            const VanillaOption::results* results =
+                dynamic_cast<const VanillaOption::results*>(
+                                                      engine.getResults());
+            QL_REQUIRE(results, "wrong result type");
+            results_ = *results;
+            if (previousValue != Null<Real>())
+                results_.errorEstimate =
+                    std::fabs(results_.value - previousValue);
+            previousValue = results_.value;
+
+            if (maxTimeSteps_ != Null<Size>() && 2*steps > maxTimeSteps_)
+                break;
+            if (!deadline.allows(4.0*cost)) {
+                deadlineReached = true;
+                break;
+            }
+            steps *= 2;
+        }
+
+        results_.additionalResults["timeSteps"] = steps;
+        results_.additionalResults["deadlineReached"] = deadlineReached;
+    }
+
+}
+
+
+#endif
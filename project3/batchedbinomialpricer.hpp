@@ -0,0 +1,216 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file batchedbinomialpricer.hpp
+    \brief Vanilla options on strike-dependent trees, priced in lanes
+*/
+
+#ifndef batched_binomial_pricer_hpp
+#define batched_binomial_pricer_hpp
+
+#include <ql/instruments/vanillaoption.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include "flatprocess.hpp"
+#include "lanerollback.hpp"
+#include "../common/instrumentation.hpp"
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Batched vanilla option pricer, one option per lane
+    /*! Trees such as LeisenReimer_2 and Joshi4_2 are centred on the
+        strike, so that options with different strikes can't share
+        one; however, with the same number of steps, the trees of
+        different options can be rolled back together. The options
+        are thus taken in groups of Lanes, each with its own tree
+        built on a FlatBlackScholesProcess_2, and each group is rolled
+        back by a LaneBinomialRollback_2, so that each value is the
+        one of BinomialVanillaRollback_2 up to rounding.
+
+        The groups are distributed among threads; options for which
+        the tree can't be built, e.g., because of negative
+        probabilities, get Null<Real>().
+    */
+    template <class T, Size Lanes = 4>
+    class BatchedBinomialVanillaPricer_2 {
+      public:
+        //! market data and terms of an option
+        struct Problem {
+            Option::Type type;
+            Real strike, spot;
+            Rate riskFreeRate, dividendYield;
+            Volatility volatility;
+            Time maturity;
+            //! maturity for a European option
+            Time firstExercise;
+        };
+        /*! \param threads  worker threads; 0 for one per core */
+        explicit BatchedBinomialVanillaPricer_2(Size timeSteps,
+                                                Size threads = 0)
+        : timeSteps_(timeSteps), threads_(threads) {
+            QL_REQUIRE(timeSteps >= 2,
+                       "at least 2 time steps required, "
+                       << timeSteps << " provided");
+            if (threads_ == 0)
+                threads_ = std::max<Size>(
+                               boost::thread::hardware_concurrency(), 1);
+        }
+        /*! values of the options, on the market data read from the
+            process as in BinomialVanillaEngine_2
+        */
+        std::vector<Real> calculate(
+             const std::vector<boost::shared_ptr<VanillaOption> >& options,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                                                         process) const;
+        //! values of the given problems
+        std::vector<Real> calculate(
+                             const std::vector<Problem>& problems) const;
+      private:
+        class Worker;
+        void rollback(const Problem* problems, Size n, Real* results,
+                      const boost::shared_ptr<FlatBlackScholesProcess_2>&,
+                      LaneBinomialRollback_2<T, Lanes>& lanes) const;
+        Size timeSteps_, threads_;
+    };
+
+
+    // template definitions
+
+    template <class T, Size Lanes>
+    class BatchedBinomialVanillaPricer_2<T, Lanes>::Worker {
+      public:
+        Worker(const BatchedBinomialVanillaPricer_2<T, Lanes>& pricer,
+               const std::vector<Problem>& problems,
+               std::vector<Real>& results,
+               boost::atomic<Size>& next)
+        : pricer_(pricer), problems_(problems), results_(results),
+          next_(next) {}
+        void operator()() const {
+            boost::shared_ptr<FlatBlackScholesProcess_2> process(
+                                            new FlatBlackScholesProcess_2);
+            LaneBinomialRollback_2<T, Lanes> lanes;
+            for (;;) {
+                Size first = next_.fetch_add(Lanes);
+                if (first >= problems_.size())
+                    return;
+                Size n = std::min(Lanes, problems_.size()-first);
+                try {
+                    pricer_.rollback(&problems_[first], n,
+                                     &results_[first], process, lanes);
+                } catch (std::exception&) {
+                    // price the group one lane at a time, so that only
+                    // the failing options are lost
+                    for (Size l=0; l<n; ++l) {
+                        try {
+                            pricer_.rollback(&problems_[first+l], 1,
+                                             &results_[first+l],
+                                             process, lanes);
+                        } catch (std::exception&) {
+                            results_[first+l] = Null<Real>();
+                        }
+                    }
+                }
+            }
+        }
+      private:
+        const BatchedBinomialVanillaPricer_2<T, Lanes>& pricer_;
+        const std::vector<Problem>& problems_;
+        std::vector<Real>& results_;
+        boost::atomic<Size>& next_;
+    };
+
+
+    template <class T, Size Lanes>
+    std::vector<Real> BatchedBinomialVanillaPricer_2<T, Lanes>::calculate(
+             const std::vector<boost::shared_ptr<VanillaOption> >& options,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                                                       process) const {
+        std::vector<Problem> problems(options.size());
+        for (Size i=0; i<options.size(); ++i) {
+            boost::shared_ptr<PlainVanillaPayoff> payoff =
+                boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                                                    options[i]->payoff());
+            QL_REQUIRE(payoff, "non-plain payoff given");
+            boost::shared_ptr<Exercise> exercise = options[i]->exercise();
+            QL_REQUIRE(exercise->type() != Exercise::Bermudan,
+                       "Bermudan exercise not supported");
+            FlatVanillaData_2 data(*process, *exercise);
+            Problem& p = problems[i];
+            p.type = payoff->optionType();
+            p.strike = payoff->strike();
+            p.spot = data.spot;
+            p.riskFreeRate = data.riskFreeRate;
+            p.dividendYield = data.dividendYield;
+            p.volatility = data.volatility;
+            p.maturity = data.maturity;
+            p.firstExercise = data.firstExercise;
+        }
+        return calculate(problems);
+    }
+
+
+    template <class T, Size Lanes>
+    std::vector<Real> BatchedBinomialVanillaPricer_2<T, Lanes>::calculate(
+                             const std::vector<Problem>& problems) const {
+
+        IMT_TRACE_SCOPE("binomial.batched.calculate");
+
+        std::vector<Real> results(problems.size());
+        boost::atomic<Size> next(0);
+        Worker worker(*this, problems, results, next);
+        Size groups = (problems.size() + Lanes - 1)/Lanes;
+        Size threads = std::min(threads_, groups);
+        boost::thread_group workers;
+        for (Size i=1; i<threads; ++i)
+            workers.create_thread(worker);
+        worker();
+        workers.join_all();
+        IMT_COUNT("binomial.batched.groups", groups);
+        return results;
+    }
+
+
+    template <class T, Size Lanes>
+    void BatchedBinomialVanillaPricer_2<T, Lanes>::rollback(
+                                      const Problem* problems, Size n,
+                                      Real* results,
+                      const boost::shared_ptr<FlatBlackScholesProcess_2>&
+                                                                   process,
+                          LaneBinomialRollback_2<T, Lanes>& lanes) const {
+        // the last lanes repeat the last option
+        for (Size l=0; l<Lanes; ++l) {
+            const Problem& problem = problems[std::min(l, n-1)];
+            QL_REQUIRE(problem.spot > 0.0 && problem.volatility > 0.0 &&
+                       problem.maturity > 0.0,
+                       "non-positive spot, volatility or maturity");
+            process->reset(problem.spot, problem.riskFreeRate,
+                           problem.dividendYield, problem.volatility);
+            T tree(process, problem.maturity, timeSteps_, problem.strike);
+            lanes.setLane(l, tree, problem.type, problem.strike,
+                          problem.riskFreeRate, problem.maturity,
+                          problem.firstExercise);
+        }
+        lanes.rollback(results, n);
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,528 @@
+
+#include "binomialtree.hpp"
+#include "binomialengine.hpp"
+#include "../project1/mceuropeanengine.hpp"
+#include "../common/columnarfile.hpp"
+#include "../common/csvtable.hpp"
+#include "../common/shardrunner.hpp"
+#include <ql/quantlib.hpp>
+#include <ql/utilities/dataparsers.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+
+using namespace QuantLib;
+
+/* Streaming batch pricer for vanilla options.
+
+   usage: batchpricer [options] [input.csv [output.csv]]
+
+   Trades are read as CSV from the input file (or standard input)
+   with a header line naming at least the columns
+
+       id,type,strike,expiry,exercise,spot,rate,dividend,volatility
+
+   where type is "call" or "put", expiry an ISO date, exercise
+   "european" or "american", and rates and volatility are
+   continuously-compounded annual figures. Results are written to
+   the output file (or standard output) as
+
+       id,npv,delta,gamma,theta,vega,error
+
+   in the same order as the input; greeks not provided by the engine
+   are left empty, and trades that cannot be priced get a message in
+   the error column instead of stopping the run.
+
+   Trades are processed in chunks: each chunk is read, priced in
+   parallel and written before the next one is read, so that memory
+   does not depend on the size of the input.
+
+   If the input file has the .qlb extension, it is mapped as a binary
+   book (see columnarfile.hpp and bookconverter.cpp) and the results
+   are written to the output file, which is required, as a binary
+   results file with one row per option in the same order. Binary
+   books can also be priced by several processes, each forked with
+   a copy of the configuration and writing the rows of its chunks
+   directly into the mapped results; a process that dies is
+   replaced by one pricing the chunks it hadn't finished.
+
+   options:
+       --engine NAME  jr, crr, eqp, trigeorgis, tian, lr, joshi4
+                      (BinomialVanillaEngine_2 on the given tree)
+                      or mc (MCEuropeanEngine_2); default crr
+       --steps N      tree or path steps; default 500 for trees, 1 for mc
+       --samples N    Monte Carlo samples; default 100000
+       --seed N       Monte Carlo seed; default 42
+       --threads N    worker threads per process; default one per core
+       --processes N  worker processes for binary books; default 0,
+                      i.e., pricing in this process
+       --chunk N      trades per chunk; default 4096
+       --date D       ISO valuation date; default today
+*/
+
+namespace {
+
+    struct Configuration {
+        std::string engine;
+        Size steps, samples, threads, chunk, processes;
+        BigNatural seed;
+        Date valuationDate;
+    };
+
+    struct Trade {
+        std::string id;
+        Option::Type type;
+        Real strike;
+        Date expiry;
+        bool american;
+        Real spot;
+        Rate rate, dividend;
+        Volatility volatility;
+        std::string error;
+    };
+
+    struct TradeResult {
+        Real npv, delta, gamma, theta, vega, errorEstimate;
+        std::string error;
+    };
+
+    typedef boost::shared_ptr<PricingEngine> (*EngineFactory)(
+                  const boost::shared_ptr<GeneralizedBlackScholesProcess>&,
+                  const Configuration&);
+
+    template <class T>
+    boost::shared_ptr<PricingEngine> treeEngine(
+               const boost::shared_ptr<GeneralizedBlackScholesProcess>& p,
+               const Configuration& configuration) {
+        return boost::shared_ptr<PricingEngine>(
+                  new BinomialVanillaEngine_2<T>(p, configuration.steps));
+    }
+
+    boost::shared_ptr<PricingEngine> mcEngine(
+               const boost::shared_ptr<GeneralizedBlackScholesProcess>& p,
+               const Configuration& configuration) {
+        return MakeMCEuropeanEngine_2<PseudoRandom>(p)
+            .withSteps(configuration.steps)
+            .withSamples(configuration.samples)
+            .withSeed(configuration.seed)
+            .withGreeks();
+    }
+
+    EngineFactory engineFactory(const std::string& name) {
+        if (name == "jr")
+            return &treeEngine<JarrowRudd_2>;
+        else if (name == "crr")
+            return &treeEngine<CoxRossRubinstein_2>;
+        else if (name == "eqp")
+            return &treeEngine<AdditiveEQPBinomialTree_2>;
+        else if (name == "trigeorgis")
+            return &treeEngine<Trigeorgis_2>;
+        else if (name == "tian")
+            return &treeEngine<Tian_2>;
+        else if (name == "lr")
+            return &treeEngine<LeisenReimer_2>;
+        else if (name == "joshi4")
+            return &treeEngine<Joshi4_2>;
+        else if (name == "mc")
+            return &mcEngine;
+        else
+            QL_FAIL("unknown engine: " << name);
+    }
+
+    const char* requiredColumns[] = { "id", "type", "strike", "expiry",
+                                      "exercise", "spot", "rate",
+                                      "dividend", "volatility" };
+
+    Trade parseTrade(const std::string& line, const CsvColumns& columns) {
+        std::vector<std::string> fields = splitCsvLine(line);
+        Trade trade;
+        // kept for the error report if the id column is missing
+        trade.id = fields.front();
+        try {
+            trade.id = columns.field(fields, "id");
+            std::string type = columns.field(fields, "type");
+            if (type == "call")
+                trade.type = Option::Call;
+            else if (type == "put")
+                trade.type = Option::Put;
+            else
+                QL_FAIL("unknown option type: " << type);
+            std::string exercise = columns.field(fields, "exercise");
+            if (exercise == "european")
+                trade.american = false;
+            else if (exercise == "american")
+                trade.american = true;
+            else
+                QL_FAIL("unknown exercise: " << exercise);
+            trade.expiry =
+                DateParser::parseISO(columns.field(fields, "expiry"));
+            trade.strike = boost::lexical_cast<Real>(
+                                         columns.field(fields, "strike"));
+            trade.spot = boost::lexical_cast<Real>(
+                                           columns.field(fields, "spot"));
+            trade.rate = boost::lexical_cast<Real>(
+                                           columns.field(fields, "rate"));
+            trade.dividend = boost::lexical_cast<Real>(
+                                       columns.field(fields, "dividend"));
+            trade.volatility = boost::lexical_cast<Real>(
+                                     columns.field(fields, "volatility"));
+        } catch (std::exception& e) {
+            trade.error = e.what();
+        }
+        return trade;
+    }
+
+    /* The engine is driven through its arguments and results rather
+       than through an instrument, since instruments register with the
+       global evaluation date and the observer pattern is not thread
+       safe. All other objects are local to the trade.
+    */
+    void price(const Trade& trade, const Configuration& configuration,
+               EngineFactory factory, TradeResult& result) {
+        result.npv = result.delta = result.gamma = Null<Real>();
+        result.theta = result.vega = result.errorEstimate = Null<Real>();
+        result.error = trade.error;
+        if (!result.error.empty())
+            return;
+        try {
+            QL_REQUIRE(!trade.american || configuration.engine != "mc",
+                       "the Monte Carlo engine only prices "
+                       "European options");
+            const Date& today = configuration.valuationDate;
+            DayCounter dayCounter = Actual365Fixed();
+            Handle<Quote> spot(
+                boost::shared_ptr<Quote>(new SimpleQuote(trade.spot)));
+            Handle<YieldTermStructure> riskFree(
+                boost::shared_ptr<YieldTermStructure>(
+                    new FlatForward(today, trade.rate, dayCounter)));
+            Handle<YieldTermStructure> dividends(
+                boost::shared_ptr<YieldTermStructure>(
+                    new FlatForward(today, trade.dividend, dayCounter)));
+            Handle<BlackVolTermStructure> volatility(
+                boost::shared_ptr<BlackVolTermStructure>(
+                    new BlackConstantVol(today, TARGET(),
+                                         trade.volatility, dayCounter)));
+            boost::shared_ptr<GeneralizedBlackScholesProcess> process(
+                new BlackScholesMertonProcess(spot, dividends,
+                                              riskFree, volatility));
+
+            boost::shared_ptr<PricingEngine> engine =
+                factory(process, configuration);
+            engine->reset();
+            VanillaOption::arguments* arguments =
+                dynamic_cast<VanillaOption::arguments*>(
+                                                  engine->getArguments());
+            QL_REQUIRE(arguments, "wrong argument type");
+            arguments->payoff = boost::shared_ptr<Payoff>(
+                           new PlainVanillaPayoff(trade.type, trade.strike));
+            if (trade.american)
+                arguments->exercise = boost::shared_ptr<Exercise>(
+                                  new AmericanExercise(today, trade.expiry));
+            else
+                arguments->exercise = boost::shared_ptr<Exercise>(
+                                          new EuropeanExercise(trade.expiry));
+            arguments->validate();
+            engine->calculate();
+
+            const VanillaOption::results* results =
+                dynamic_cast<const VanillaOption::results*>(
+                                                    engine->getResults());
+            QL_REQUIRE(results, "wrong result type");
+            result.npv = results->value;
+            result.delta = results->delta;
+            result.gamma = results->gamma;
+            result.theta = results->theta;
+            result.vega = results->vega;
+            result.errorEstimate = results->errorEstimate;
+        } catch (std::exception& e) {
+            result.error = e.what();
+        }
+    }
+
+    // prices trades [0, n) with the next free worker taking the next trade
+    class Worker {
+      public:
+        Worker(const std::vector<Trade>& trades,
+               std::vector<TradeResult>& results,
+               boost::atomic<Size>& next,
+               const Configuration& configuration,
+               EngineFactory factory)
+        : trades_(trades), results_(results), next_(next),
+          configuration_(configuration), factory_(factory) {}
+        void operator()() const {
+            for (;;) {
+                Size i = next_.fetch_add(1);
+                if (i >= trades_.size())
+                    return;
+                price(trades_[i], configuration_, factory_, results_[i]);
+            }
+        }
+      private:
+        const std::vector<Trade>& trades_;
+        std::vector<TradeResult>& results_;
+        boost::atomic<Size>& next_;
+        const Configuration& configuration_;
+        EngineFactory factory_;
+    };
+
+    // same as Worker, reading rows [next, end) from a book and
+    // writing to its results
+    class BookWorker {
+      public:
+        BookWorker(const BookFile& book, const ResultsFile& results,
+                   boost::atomic<Size>& next, Size end,
+                   const Configuration& configuration,
+                   EngineFactory factory)
+        : book_(book), results_(results), next_(next), end_(end),
+          configuration_(configuration), factory_(factory) {}
+        void operator()() const {
+            Trade trade;
+            TradeResult result;
+            for (;;) {
+                Size i = next_.fetch_add(1);
+                if (i >= end_)
+                    return;
+                Size u = book_.underlyingIndices()[i];
+                trade.type = book_.type(i);
+                trade.strike = book_.strikes()[i];
+                trade.expiry = book_.expiry(i);
+                trade.american = book_.american(i);
+                trade.spot = book_.spots()[u];
+                trade.rate = book_.rates()[u];
+                trade.dividend = book_.dividends()[u];
+                trade.volatility = book_.volatilities()[u];
+                price(trade, configuration_, factory_, result);
+                results_.npvs()[i] = nanIfNull(result.npv);
+                results_.deltas()[i] = nanIfNull(result.delta);
+                results_.gammas()[i] = nanIfNull(result.gamma);
+                results_.thetas()[i] = nanIfNull(result.theta);
+                results_.errorEstimates()[i] =
+                    nanIfNull(result.errorEstimate);
+                results_.statuses()[i] = result.error.empty() ? 0 : 1;
+            }
+        }
+      private:
+        static Real nanIfNull(Real x) {
+            return x == Null<Real>() ?
+                std::numeric_limits<Real>::quiet_NaN() : x;
+        }
+        const BookFile& book_;
+        const ResultsFile& results_;
+        boost::atomic<Size>& next_;
+        Size end_;
+        const Configuration& configuration_;
+        EngineFactory factory_;
+    };
+
+    void priceBookRows(const BookFile& book, const ResultsFile& results,
+                       Size begin, Size end,
+                       const Configuration& configuration,
+                       EngineFactory factory) {
+        boost::atomic<Size> next(begin);
+        BookWorker worker(book, results, next, end, configuration, factory);
+        Size threads = std::min(configuration.threads, end-begin);
+        boost::thread_group workers;
+        for (Size i=1; i<threads; ++i)
+            workers.create_thread(worker);
+        worker();
+        workers.join_all();
+    }
+
+    // the results go to the shared mapping, so none is returned
+    std::string priceBookChunk(const BookFile& book,
+                               const ResultsFile& results,
+                               const Configuration& configuration,
+                               EngineFactory factory,
+                               Size chunk) {
+        Size begin = chunk*configuration.chunk;
+        Size end = std::min(begin+configuration.chunk, book.rows());
+        priceBookRows(book, results, begin, end, configuration, factory);
+        return std::string();
+    }
+
+    bool hasExtension(const std::string& file,
+                      const std::string& extension) {
+        return file.size() >= extension.size() &&
+            file.compare(file.size()-extension.size(), extension.size(),
+                         extension) == 0;
+    }
+
+    void writeField(std::ostream& out, Real x) {
+        out << ",";
+        if (x != Null<Real>())
+            out << x;
+    }
+
+    void writeResult(std::ostream& out, const Trade& trade,
+                     const TradeResult& result) {
+        out << trade.id;
+        writeField(out, result.npv);
+        writeField(out, result.delta);
+        writeField(out, result.gamma);
+        writeField(out, result.theta);
+        writeField(out, result.vega);
+        out << ",";
+        if (!result.error.empty()) {
+            // quoted, with inner quotes doubled
+            out << "\"";
+            for (Size i=0; i<result.error.size(); ++i) {
+                if (result.error[i] == '"')
+                    out << "\"";
+                out << (result.error[i] == '\n' ? ' ' : result.error[i]);
+            }
+            out << "\"";
+        }
+        out << "\n";
+    }
+
+    Size parseSize(const std::string& option, const std::string& value) {
+        try {
+            return boost::lexical_cast<Size>(value);
+        } catch (boost::bad_lexical_cast&) {
+            QL_FAIL("invalid value for " << option << ": " << value);
+        }
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+
+        Configuration configuration;
+        configuration.engine = "crr";
+        configuration.steps = Null<Size>();
+        configuration.samples = 100000;
+        configuration.seed = 42;
+        configuration.threads = boost::thread::hardware_concurrency();
+        configuration.chunk = 4096;
+        configuration.processes = 0;
+        configuration.valuationDate = Date::todaysDate();
+
+        std::vector<std::string> files;
+        for (int i=1; i<argc; ++i) {
+            std::string option = argv[i];
+            if (option.compare(0, 2, "--") != 0) {
+                files.push_back(option);
+                continue;
+            }
+            QL_REQUIRE(i+1 < argc, "missing value for " << option);
+            std::string value = argv[++i];
+            if (option == "--engine")
+                configuration.engine = value;
+            else if (option == "--steps")
+                configuration.steps = parseSize(option, value);
+            else if (option == "--samples")
+                configuration.samples = parseSize(option, value);
+            else if (option == "--seed")
+                configuration.seed = parseSize(option, value);
+            else if (option == "--threads")
+                configuration.threads = parseSize(option, value);
+            else if (option == "--chunk")
+                configuration.chunk = parseSize(option, value);
+            else if (option == "--processes")
+                configuration.processes = parseSize(option, value);
+            else if (option == "--date")
+                configuration.valuationDate = DateParser::parseISO(value);
+            else
+                QL_FAIL("unknown option: " << option);
+        }
+        QL_REQUIRE(files.size() <= 2, "too many arguments");
+        QL_REQUIRE(configuration.chunk > 0, "empty chunks");
+        if (configuration.threads == 0)
+            configuration.threads = 1;
+        if (configuration.steps == Null<Size>())
+            configuration.steps = (configuration.engine == "mc" ? 1 : 500);
+        EngineFactory factory = engineFactory(configuration.engine);
+
+        // set once, before any worker starts, and only read afterwards
+        Settings::instance().evaluationDate() = configuration.valuationDate;
+
+        if (files.size() > 0 && hasExtension(files[0], ".qlb")) {
+            QL_REQUIRE(files.size() == 2,
+                       "an output file is required for binary books");
+            BookFile book(files[0]);
+            ResultsFile results(files[1], book.rows());
+            if (configuration.processes > 0) {
+                Size chunks = (book.rows() + configuration.chunk - 1) /
+                              configuration.chunk;
+                ShardRunner runner(configuration.processes);
+                runner.run(chunks,
+                           boost::bind(&priceBookChunk,
+                                       boost::cref(book),
+                                       boost::cref(results),
+                                       boost::cref(configuration),
+                                       factory, _1));
+            } else {
+                priceBookRows(book, results, 0, book.rows(),
+                              configuration, factory);
+            }
+            results.flush();
+            return 0;
+        }
+
+        std::ifstream inputFile;
+        if (files.size() > 0) {
+            inputFile.open(files[0].c_str());
+            QL_REQUIRE(inputFile, "cannot open " << files[0]);
+        }
+        std::istream& input = files.size() > 0 ? inputFile : std::cin;
+        std::ofstream outputFile;
+        if (files.size() > 1) {
+            outputFile.open(files[1].c_str());
+            QL_REQUIRE(outputFile, "cannot open " << files[1]);
+        }
+        std::ostream& output = files.size() > 1 ? outputFile : std::cout;
+        output << std::setprecision(12);
+
+        std::string line;
+        QL_REQUIRE(std::getline(input, line), "missing header line");
+        CsvColumns columns(line);
+        for (Size i=0; i<sizeof(requiredColumns)/sizeof(char*); ++i)
+            columns.require(requiredColumns[i]);
+        output << "id,npv,delta,gamma,theta,vega,error\n";
+
+        std::vector<Trade> trades;
+        std::vector<TradeResult> results;
+        trades.reserve(configuration.chunk);
+        bool more = true;
+        while (more) {
+            trades.clear();
+            while (trades.size() < configuration.chunk &&
+                   (more = bool(std::getline(input, line)))) {
+                if (!trimCsvField(line).empty())
+                    trades.push_back(parseTrade(line, columns));
+            }
+            if (trades.empty())
+                break;
+
+            results.resize(trades.size());
+            boost::atomic<Size> next(0);
+            Worker worker(trades, results, next, configuration, factory);
+            Size threads = std::min(configuration.threads, trades.size());
+            boost::thread_group workers;
+            for (Size i=1; i<threads; ++i)
+                workers.create_thread(worker);
+            worker();
+            workers.join_all();
+
+            for (Size i=0; i<trades.size(); ++i)
+                writeResult(output, trades[i], results[i]);
+            output.flush();
+        }
+
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
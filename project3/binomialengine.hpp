@@ -32,6 +32,12 @@
 #include <ql/processes/blackscholesprocess.hpp>
 #include <ql/termstructures/yield/flatforward.hpp>
 #include <ql/termstructures/volatility/equityfx/blackconstantvol.hpp>
+#include "bsmlattice.hpp"
+#include "blockedrollback.hpp"
+#include "flatprocess.hpp"
+#include <algorithm>
+#include <vector>
+#include "../common/instrumentation.hpp"
 
 namespace QuantLib {
     
@@ -44,23 +50,62 @@ namespace QuantLib {
      current time. The value would be fetched from the middle
      one, while the two side points would be used for
      estimating partial derivatives.
+
+     If a truncation is given, only the nodes within that many
+     standard deviations of the forward are rolled back (see
+     TruncatedBlackScholesLattice_2); 6 to 8 leave the results
+     unchanged to many digits while the work grows as N^1.5 instead
+     of N^2.
+
+     With a widening m larger than 1, the tree has 2m+1 nodes at t=0
+     and the same rollback also gives a spot ladder, stored in the
+     additional results as "spotLadder", "npvLadder", "deltaLadder"
+     and "gammaLadder"; delta and gamma at each level come from the
+     quadratic through it and its neighbours. If ladder spots are
+     given, the ladder is interpolated on them instead, quadratically
+     on the three nearest nodes; they must lie within the outer nodes.
+
+     If rollback threads are given, the tree is rolled back by
+     BlockedRollback_2 on that many threads (0 for one per core),
+     which gives identical results and pays off for trees with tens
+     of thousands of steps; it can't be combined with a truncation.
      */
     template <class T>
     class BinomialVanillaEngine_2 : public VanillaOption::engine {
     public:
         BinomialVanillaEngine_2(
                                 const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
-                                Size timeSteps)
-        : process_(process), timeSteps_(timeSteps) {
+                                Size timeSteps,
+                                Real truncation = Null<Real>(),
+                                Size widening = 1,
+                                const std::vector<Real>& ladderSpots =
+                                                          std::vector<Real>(),
+                                Size rollbackThreads = Null<Size>())
+        : process_(process), timeSteps_(timeSteps), truncation_(truncation),
+          widening_(widening), ladderSpots_(ladderSpots),
+          rollbackThreads_(rollbackThreads) {
             QL_REQUIRE(timeSteps >= 2,
                        "at least 2 time steps required, "
                        << timeSteps << " provided");
+            QL_REQUIRE(truncation == Null<Real>() || truncation > 0.0,
+                       "positive truncation required, "
+                       << truncation << " provided");
+            QL_REQUIRE(widening >= 1, "widening must be at least 1");
+            QL_REQUIRE(truncation == Null<Real>() ||
+                       rollbackThreads == Null<Size>(),
+                       "blocked rollback not available with truncation");
             registerWith(process_);
         }
         void calculate() const;
     private:
+        static void quadratic(const Real* s, const Real* v, Real x,
+                              Real& value, Real& delta, Real& gamma);
         boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
         Size timeSteps_;
+        Real truncation_;
+        Size widening_;
+        std::vector<Real> ladderSpots_;
+        Size rollbackThreads_;
     };
     
     
@@ -69,71 +114,124 @@ namespace QuantLib {
     template <class T>
     void BinomialVanillaEngine_2<T>::calculate() const {
         
-        DayCounter rfdc  = process_->riskFreeRate()->dayCounter();
-        DayCounter divdc = process_->dividendYield()->dayCounter();
-        DayCounter voldc = process_->blackVolatility()->dayCounter();
-        Calendar volcal = process_->blackVolatility()->calendar();
+        IMT_TRACE_SCOPE("binomial.calculate");
+        IMT_TRACE_BEGIN(setupSpan, "binomial.setup");
         
-        Real s0 = process_->stateVariable()->value();
-        QL_REQUIRE(s0 > 0.0, "negative or null underlying given");
-        Volatility v = process_->blackVolatility()->blackVol(
-                                                             arguments_.exercise->lastDate(), s0);
-        Date maturityDate = arguments_.exercise->lastDate();
-        Rate r = process_->riskFreeRate()->zeroRate(maturityDate,
-                                                    rfdc, Continuous, NoFrequency);
-        Rate q = process_->dividendYield()->zeroRate(maturityDate,
-                                                     divdc, Continuous, NoFrequency);
-        Date referenceDate = process_->riskFreeRate()->referenceDate();
+        FlatVanillaData_2 data(*process_, *arguments_.exercise);
+        Real s0 = data.spot;
+        Rate r = data.riskFreeRate;
+        Time maturity = data.maturity;
+        const Date& referenceDate = data.referenceDate;
         
         // binomial trees with constant coefficient
         Handle<YieldTermStructure> flatRiskFree(
-                                                boost::shared_ptr<YieldTermStructure>(
-                                                                                      new FlatForward(referenceDate, r, rfdc)));
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(referenceDate, r,
+                                process_->riskFreeRate()->dayCounter())));
         Handle<YieldTermStructure> flatDividends(
-                                                 boost::shared_ptr<YieldTermStructure>(
-                                                                                       new FlatForward(referenceDate, q, divdc)));
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(referenceDate, data.dividendYield,
+                                process_->dividendYield()->dayCounter())));
         Handle<BlackVolTermStructure> flatVol(
-                                              boost::shared_ptr<BlackVolTermStructure>(
-                                                                                       new BlackConstantVol(referenceDate, volcal, v, voldc)));
+            boost::shared_ptr<BlackVolTermStructure>(
+                new BlackConstantVol(
+                             referenceDate,
+                             process_->blackVolatility()->calendar(),
+                             data.volatility,
+                             process_->blackVolatility()->dayCounter())));
         
         boost::shared_ptr<PlainVanillaPayoff> payoff =
         boost::dynamic_pointer_cast<PlainVanillaPayoff>(arguments_.payoff);
         QL_REQUIRE(payoff, "non-plain payoff given");
         
-        Time maturity = rfdc.yearFraction(referenceDate, maturityDate);
-        
         boost::shared_ptr<StochasticProcess1D> bs(
                                                   new GeneralizedBlackScholesProcess(
                                                                                      process_->stateVariable(),
                                                                                      flatDividends, flatRiskFree, flatVol));
+        IMT_TRACE_END(setupSpan);
         
+        IMT_TRACE_BEGIN(treeSpan, "binomial.tree");
         TimeGrid grid(maturity, timeSteps_);
         
         boost::shared_ptr<T> tree(new T(bs, maturity, timeSteps_,
-                                        payoff->strike()));
+                                        payoff->strike(), widening_));
         
-        boost::shared_ptr<BlackScholesLattice<T> > lattice(
-                                                           new BlackScholesLattice<T>(tree, r, maturity, timeSteps_));
-        
-        DiscretizedVanillaOption option(arguments_, *process_, grid);
-        
-        option.initialize(lattice, maturity);
+        boost::shared_ptr<Lattice> lattice;
+        if (rollbackThreads_ != Null<Size>()) {
+            // no lattice; see the blocked rollback below
+            IMT_COUNT("binomial.nodes",
+                      (T::branches-1)*timeSteps_*(timeSteps_-1)/2
+                      + (2*widening_+1)*timeSteps_);
+        } else if (truncation_ == Null<Real>()) {
+            lattice = boost::shared_ptr<Lattice>(
+                         new BlackScholesLattice_2<T>(tree, r, maturity, timeSteps_));
+            // nodes evaluated by the rollback: step i has (branches-1)*i+2m+1
+            IMT_COUNT("binomial.nodes",
+                      (T::branches-1)*timeSteps_*(timeSteps_-1)/2
+                      + (2*widening_+1)*timeSteps_);
+        } else {
+            bool americanExercise =
+                arguments_.exercise->type() != Exercise::European;
+            boost::shared_ptr<TruncatedBlackScholesLattice_2<T> > truncated(
+                new TruncatedBlackScholesLattice_2<T>(tree, bs, r, maturity,
+                                                      timeSteps_, payoff,
+                                                      americanExercise,
+                                                      truncation_));
+            IMT_COUNT("binomial.nodes", truncated->rolledBackNodes());
+            lattice = truncated;
+        }
         
-        // Partial derivatives calculated from various points in the
-        // binomial tree
-        // (see J.C.Hull, "Options, Futures and other derivatives", 6th edition, pp 397/398)
+        IMT_TRACE_END(treeSpan);
         
-        // Rollback to third-last step, and get underlying prices (s2) &
-        // option values (p2) at this point
-        option.rollback(grid[0]);
-        Array va0(option.values());
-        QL_ENSURE(va0.size() == 3, "Expect 3 nodes in grid at t = 0");
-        Real p0u_d = va0[2]; // up
-        Real p0 = va0[1]; // mid
-        Real p0d_u = va0[0]; // down (low)
-        Real s0u_d = lattice->underlying(0, 2); // up price
-        s0 = lattice->underlying(0, 1); // middle price
-        Real s0d_u = lattice->underlying(0, 0); // down (low) price
+        Array va0;
+        if (lattice) {
+            IMT_TRACE_BEGIN(initializeSpan, "binomial.initialize");
+            DiscretizedVanillaOption option(arguments_, *process_, grid);
+
+            option.initialize(lattice, maturity);
+            IMT_TRACE_END(initializeSpan);
+
+            // Partial derivatives calculated from various points in the
+            // binomial tree
+            // (see J.C.Hull, "Options, Futures and other derivatives", 6th edition, pp 397/398)
+
+            // Rollback to t=0, and get underlying prices (s0) &
+            // option values (p0) at this point
+            IMT_TRACE_BEGIN(rollbackSpan, "binomial.rollback.0");
+            option.rollback(grid[0]);
+            IMT_TRACE_END(rollbackSpan);
+            va0 = option.values();
+        } else {
+            // exercise times as in DiscretizedVanillaOption
+            QL_REQUIRE(arguments_.exercise->type() != Exercise::Bermudan,
+                       "Bermudan exercise not supported "
+                       "by the blocked rollback");
+            Size firstExerciseStep = timeSteps_;
+            if (arguments_.exercise->type() == Exercise::American) {
+                // the option checks the times at or after the first
+                // exercise, so that the step is not rounded down
+                firstExerciseStep = 0;
+                while (firstExerciseStep < timeSteps_ &&
+                       grid[firstExerciseStep] < data.firstExercise)
+                    ++firstExerciseStep;
+            }
+            // same discount as BlackScholesLattice_2
+            Time dt = maturity/timeSteps_;
+            IMT_TRACE_BEGIN(rollbackSpan, "binomial.rollback.0");
+            BlockedRollback_2<T> rollback(rollbackThreads_);
+            va0 = rollback(*tree, timeSteps_, std::exp(-r*dt), *payoff,
+                           firstExerciseStep);
+            IMT_TRACE_END(rollbackSpan);
+        }
+        const Size m = widening_;
+        QL_ENSURE(va0.size() == 2*m+1,
+                  "Expect " << 2*m+1 << " nodes in grid at t = 0");
+        Real p0u_d = va0[m+1]; // up
+        Real p0 = va0[m]; // mid
+        Real p0d_u = va0[m-1]; // down (low)
+        Real s0u_d = tree->underlying(0, m+1); // up price
+        s0 = tree->underlying(0, m); // middle price
+        Real s0d_u = tree->underlying(0, m-1); // down (low) price
         
         // calculate gamma by taking the first derivate of the two deltas
         Real h1 = s0-s0d_u;
@@ -149,6 +247,57 @@ namespace QuantLib {
                                            results_.value,
                                            results_.delta,
                                            results_.gamma);
+
+        if (m > 1 || !ladderSpots_.empty()) {
+            std::vector<Real> spots(2*m+1);
+            for (Size j=0; j<2*m+1; ++j)
+                spots[j] = tree->underlying(0, j);
+            bool interpolated = !ladderSpots_.empty();
+            const std::vector<Real>& ladder =
+                interpolated ? ladderSpots_ : spots;
+            std::vector<Real> npvs(ladder.size()), deltas(ladder.size()),
+                              gammas(ladder.size());
+            for (Size k=0; k<ladder.size(); ++k) {
+                Size j = k;
+                if (interpolated) {
+                    QL_REQUIRE(ladder[k] >= spots.front() &&
+                               ladder[k] <= spots.back(),
+                               "ladder spot " << ladder[k]
+                               << " outside the tree range ["
+                               << spots.front() << ", " << spots.back()
+                               << "]; increase the widening");
+                    j = std::upper_bound(spots.begin(), spots.end(),
+                                         ladder[k]) - spots.begin();
+                    // nearest node
+                    if (j == spots.size() ||
+                        ladder[k]-spots[j-1] < spots[j]-ladder[k])
+                        --j;
+                }
+                // first of the three nodes around j
+                Size first = std::min(std::max<Size>(j, 1), 2*m-1) - 1;
+                quadratic(&spots[first], &va0[first], ladder[k],
+                          npvs[k], deltas[k], gammas[k]);
+            }
+            results_.additionalResults["spotLadder"] = ladder;
+            results_.additionalResults["npvLadder"] = npvs;
+            results_.additionalResults["deltaLadder"] = deltas;
+            results_.additionalResults["gammaLadder"] = gammas;
+        }
+    }
+
+    template <class T>
+    void BinomialVanillaEngine_2<T>::quadratic(const Real* s, const Real* v,
+                                               Real x, Real& value,
+                                               Real& delta, Real& gamma) {
+        // Lagrange polynomial through (s[i], v[i]), i = 0, 1, 2
+        Real d0 = (s[0]-s[1])*(s[0]-s[2]);
+        Real d1 = (s[1]-s[0])*(s[1]-s[2]);
+        Real d2 = (s[2]-s[0])*(s[2]-s[1]);
+        value = v[0]*(x-s[1])*(x-s[2])/d0 + v[1]*(x-s[0])*(x-s[2])/d1
+              + v[2]*(x-s[0])*(x-s[1])/d2;
+        delta = v[0]*(2.0*x-s[1]-s[2])/d0 + v[1]*(2.0*x-s[0]-s[2])/d1
+              + v[2]*(2.0*x-s[0]-s[1])/d2;
+        gamma = 2.0*(v[0]/d0 + v[1]/d1 + v[2]/d2);
     }
     
 }
@@ -27,8 +27,9 @@ namespace QuantLib {
 
     JarrowRudd_2::JarrowRudd_2(
                         const boost::shared_ptr<StochasticProcess1D>& process,
-                        Time end, Size steps, Real)
-    : EqualProbabilitiesBinomialTree_2<JarrowRudd_2>(process, end, steps) {
+                        Time end, Size steps, Real, Size widening)
+    : EqualProbabilitiesBinomialTree_2<JarrowRudd_2>(process, end, steps,
+                                                   widening) {
         // drift removed
         up_ = process->stdDeviation(0.0, x0_, dt_);
     }
@@ -36,8 +37,9 @@ namespace QuantLib {
 
     CoxRossRubinstein_2::CoxRossRubinstein_2(
                         const boost::shared_ptr<StochasticProcess1D>& process,
-                        Time end, Size steps, Real)
-    : EqualJumpsBinomialTree_2<CoxRossRubinstein_2>(process, end, steps) {
+                        Time end, Size steps, Real, Size widening)
+    : EqualJumpsBinomialTree_2<CoxRossRubinstein_2>(process, end, steps,
+                                                    widening) {
 
         dx_ = process->stdDeviation(0.0, x0_, dt_);
         pu_ = 0.5 + 0.5*driftPerStep_/dx_;;
@@ -50,9 +52,10 @@ namespace QuantLib {
 
     AdditiveEQPBinomialTree_2::AdditiveEQPBinomialTree_2(
                         const boost::shared_ptr<StochasticProcess1D>& process,
-                        Time end, Size steps, Real)
+                        Time end, Size steps, Real, Size widening)
     : EqualProbabilitiesBinomialTree_2<AdditiveEQPBinomialTree_2>(process,
-                                                                  end, steps) {
+                                                                  end, steps,
+                                                                  widening) {
         up_ = - 0.5 * driftPerStep_ + 0.5 *
             std::sqrt(4.0*process->variance(0.0, x0_, dt_)-
                       3.0*driftPerStep_*driftPerStep_);
@@ -61,8 +64,8 @@ namespace QuantLib {
 
     Trigeorgis_2::Trigeorgis_2(
                         const boost::shared_ptr<StochasticProcess1D>& process,
-                        Time end, Size steps, Real)
-    : EqualJumpsBinomialTree_2<Trigeorgis_2>(process, end, steps) {
+                        Time end, Size steps, Real, Size widening)
+    : EqualJumpsBinomialTree_2<Trigeorgis_2>(process, end, steps, widening) {
 
         dx_ = std::sqrt(process->variance(0.0, x0_, dt_)+
                         driftPerStep_*driftPerStep_);
@@ -75,8 +78,8 @@ namespace QuantLib {
 
 
     Tian_2::Tian_2(const boost::shared_ptr<StochasticProcess1D>& process,
-                   Time end, Size steps, Real)
-    : BinomialTree_2<Tian_2>(process, end, steps) {
+                   Time end, Size steps, Real, Size widening)
+    : BinomialTree_2<Tian_2>(process, end, steps, widening) {
 
         Real q = std::exp(process->variance(0.0, x0_, dt_));
         Real r = std::exp(driftPerStep_)*std::sqrt(q);
@@ -98,8 +101,10 @@ namespace QuantLib {
 
     LeisenReimer_2::LeisenReimer_2(
                         const boost::shared_ptr<StochasticProcess1D>& process,
-                        Time end, Size steps, Real strike)
-    : BinomialTree_2<LeisenReimer_2>(process, end, (steps%2 ? steps : steps+1)) {
+                        Time end, Size steps, Real strike,
+                       Size widening)
+    : BinomialTree_2<LeisenReimer_2>(process, end, (steps%2 ? steps : steps+1),
+                                     widening) {
 
         QL_REQUIRE(strike>0.0, "strike must be positive");
         Size oddSteps = (steps%2 ? steps : steps+1);
@@ -138,8 +143,10 @@ namespace QuantLib {
     }
 
     Joshi4_2::Joshi4_2(const boost::shared_ptr<StochasticProcess1D>& process,
-                       Time end, Size steps, Real strike)
-    : BinomialTree_2<Joshi4_2>(process, end, (steps%2 ? steps : steps+1)) {
+                       Time end, Size steps, Real strike,
+                       Size widening)
+    : BinomialTree_2<Joshi4_2>(process, end, (steps%2 ? steps : steps+1),
+                               widening) {
 
         QL_REQUIRE(strike>0.0, "strike must be positive");
         Size oddSteps = (steps%2 ? steps : steps+1);
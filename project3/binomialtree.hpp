@@ -33,26 +33,42 @@
 namespace QuantLib {
 
     //! Binomial tree base class
-    /*! \ingroup lattices */
+    /*! The tree is widened by 2m nodes at each step, m being the
+        widening, so that it has 2m+1 nodes at t=0, the spot being the
+        middle one; the default m=1 gives the three nodes used for
+        delta and gamma, while larger values give a ladder of spot
+        levels from the same rollback.
+
+        \ingroup lattices
+    */
     template <class T>
     class BinomialTree_2 : public Tree<T> {
       public:
         enum Branches { branches = 2 };
         BinomialTree_2(const boost::shared_ptr<StochasticProcess1D>& process,
                        Time end,
-                       Size steps)
-        : Tree<T>(steps+1) {
+                       Size steps,
+                       Size widening = 1)
+        : Tree<T>(steps+1), widening_(widening) {
+            QL_REQUIRE(widening >= 1, "widening must be at least 1");
             x0_ = process->x0();
             dt_ = end/steps;
             driftPerStep_ = process->drift(0.0, x0_) * dt_;
         }
         Size size(Size i) const {
-            return i+3;
+            return i+2*widening_+1;
         }
         Size descendant(Size, Size index, Size branch) const {
             return index + branch;
         }
+        Size widening() const { return widening_; }
       protected:
+        // up moves minus down moves to reach the given node
+        BigInteger jumps(Size i, Size index) const {
+            return 2*BigInteger(index) - BigInteger(i)
+                 - 2*BigInteger(widening_);
+        }
+        Size widening_;
         Real x0_, driftPerStep_;
         Time dt_;
     };
@@ -66,10 +82,11 @@ namespace QuantLib {
         EqualProbabilitiesBinomialTree_2(
                         const boost::shared_ptr<StochasticProcess1D>& process,
                         Time end,
-                        Size steps)
-        : BinomialTree_2<T>(process, end, steps) {}
+                        Size steps,
+                        Size widening = 1)
+        : BinomialTree_2<T>(process, end, steps, widening) {}
         Real underlying(Size i, Size index) const {
-            BigInteger j = 2*BigInteger(index) - BigInteger(i)-BigInteger(2);
+            BigInteger j = this->jumps(i, index);
             // exploiting the forward value tree centering
             return this->x0_*std::exp(i*this->driftPerStep_ + j*this->up_);
         }
@@ -87,10 +104,11 @@ namespace QuantLib {
         EqualJumpsBinomialTree_2(
                         const boost::shared_ptr<StochasticProcess1D>& process,
                         Time end,
-                        Size steps)
-        : BinomialTree_2<T>(process, end, steps) {}
+                        Size steps,
+                        Size widening = 1)
+        : BinomialTree_2<T>(process, end, steps, widening) {}
         Real underlying(Size i, Size index) const {
-            BigInteger j = 2*BigInteger(index) - BigInteger(i)-BigInteger(2);
+            BigInteger j = this->jumps(i, index);
             // exploiting equal jump and the x0_ tree centering
             return this->x0_*std::exp(j*this->dx_);
         }
@@ -109,7 +127,8 @@ namespace QuantLib {
         JarrowRudd_2(const boost::shared_ptr<StochasticProcess1D>&,
                      Time end,
                      Size steps,
-                     Real strike);
+                     Real strike,
+                     Size widening = 1);
     };
 
 
@@ -121,7 +140,8 @@ namespace QuantLib {
         CoxRossRubinstein_2(const boost::shared_ptr<StochasticProcess1D>&,
                             Time end,
                             Size steps,
-                            Real strike);
+                            Real strike,
+                            Size widening = 1);
     };
 
 
@@ -134,7 +154,8 @@ namespace QuantLib {
                         const boost::shared_ptr<StochasticProcess1D>&,
                         Time end,
                         Size steps,
-                        Real strike);
+                        Real strike,
+                        Size widening = 1);
     };
 
 
@@ -145,7 +166,8 @@ namespace QuantLib {
         Trigeorgis_2(const boost::shared_ptr<StochasticProcess1D>&,
                      Time end,
                      Size steps,
-                     Real strike);
+                     Real strike,
+                     Size widening = 1);
     };
 
 
@@ -156,10 +178,12 @@ namespace QuantLib {
         Tian_2(const boost::shared_ptr<StochasticProcess1D>&,
                Time end,
                Size steps,
-               Real strike);
+               Real strike,
+               Size widening = 1);
         Real underlying(Size i, Size index) const {
-            return x0_ * std::pow(down_, Real(BigInteger(i)-BigInteger(index))+1)
-                       * std::pow(up_, Real(index-1));
+            BigInteger ups = BigInteger(index) - BigInteger(widening_);
+            return x0_ * std::pow(down_, Real(BigInteger(i) - ups))
+                       * std::pow(up_, Real(ups));
         };
         Real probability(Size, Size, Size branch) const {
             return (branch == 1 ? pu_ : pd_);
@@ -175,10 +199,12 @@ namespace QuantLib {
         LeisenReimer_2(const boost::shared_ptr<StochasticProcess1D>&,
                        Time end,
                        Size steps,
-                       Real strike);
+                       Real strike,
+                       Size widening = 1);
         Real underlying(Size i, Size index) const {
-            return x0_ * std::pow(down_, Real(BigInteger(i)-BigInteger(index))+1)
-                       * std::pow(up_, Real(index-1));
+            BigInteger ups = BigInteger(index) - BigInteger(widening_);
+            return x0_ * std::pow(down_, Real(BigInteger(i) - ups))
+                       * std::pow(up_, Real(ups));
         }
         Real probability(Size, Size, Size branch) const {
             return (branch == 1 ? pu_ : pd_);
@@ -193,10 +219,12 @@ namespace QuantLib {
         Joshi4_2(const boost::shared_ptr<StochasticProcess1D>&,
                  Time end,
                  Size steps,
-                 Real strike);
+                 Real strike,
+                 Size widening = 1);
         Real underlying(Size i, Size index) const {
-            return x0_ * std::pow(down_, Real(BigInteger(i)-BigInteger(index))+1)   //
-                       * std::pow(up_, Real(index-1));
+            BigInteger ups = BigInteger(index) - BigInteger(widening_);
+            return x0_ * std::pow(down_, Real(BigInteger(i) - ups))
+                       * std::pow(up_, Real(ups));
         }
         Real probability(Size, Size, Size branch) const {
             return (branch == 1 ? pu_ : pd_);
@@ -0,0 +1,250 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file blockedrollback.hpp
+    \brief Cache-blocked, multi-threaded rollback of large trees
+*/
+
+#ifndef blocked_rollback_hpp
+#define blocked_rollback_hpp
+
+#include "bsmlattice.hpp"
+#include <ql/instruments/payoffs.hpp>
+#include <ql/math/array.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Cache-blocked, multi-threaded rollback of a vanilla option
+    /*! The option values are rolled back on a single buffer, a block
+        of several time steps at a time. Within a block, each slice is
+        cut into tiles; a first phase rolls each tile back over the
+        whole block, on a range shrinking by branches-1 nodes at each
+        step (an upright trapezoid), so that the tile stays in cache
+        and no tile depends on another; a second phase fills the
+        triangles left between neighbouring tiles from the first
+        phase's results. All threads go through the two phases of each
+        block together, and the tiles of a phase are shared among
+        them.
+
+        Every node is computed once, with the same operations as
+        BlackScholesLattice_2 and DiscretizedVanillaOption, so that
+        the results are identical to those of the serial rollback.
+
+        The tree must have constant probabilities and descendants
+        j, j+1, ... of node j, as required by BlackScholesLattice_2.
+    */
+    template <class T>
+    class BlockedRollback_2 {
+      public:
+        /*! \param threads     worker threads; 0 for one per core
+            \param blockSteps  time steps rolled back per block
+            \param tileNodes   minimum nodes per tile
+        */
+        explicit BlockedRollback_2(Size threads = 0,
+                                   Size blockSteps = 64,
+                                   Size tileNodes = 4096);
+        /*! Returns the option values at t=0, from the values of the
+            payoff at the last step of the tree; early exercise is
+            checked at steps from firstExerciseStep on.
+        */
+        Array operator()(const T& tree,
+                         Size steps,
+                         DiscountFactor discount,
+                         const Payoff& payoff,
+                         Size firstExerciseStep) const;
+      private:
+        struct Job {
+            const T* tree;
+            DiscountFactor discount;
+            const Payoff* payoff;
+            Size firstExerciseStep;
+            const Real* probabilities;
+            std::vector<Real> values, edges;
+        };
+        class Worker;
+        struct Band {
+            Size steps, nodes, width, tiles;
+        };
+        Band band(const T& tree, Size step) const;
+        void tile(Job& job, Size step, const Band& band, Size t) const;
+        void gap(Job& job, Size step, const Band& band, Size t) const;
+        Size threads_, blockSteps_, tileNodes_;
+    };
+
+
+    // template definitions
+
+    template <class T>
+    class BlockedRollback_2<T>::Worker {
+      public:
+        Worker(const BlockedRollback_2<T>& rollback, Job& job,
+               Size steps, Size id, Size threads, boost::barrier& barrier)
+        : rollback_(rollback), job_(job), steps_(steps), id_(id),
+          threads_(threads), barrier_(barrier) {}
+        void operator()() const {
+            // all threads go through the same sequence of blocks
+            for (Size step=steps_; step>0;) {
+                Band band = rollback_.band(*job_.tree, step);
+                for (Size t=id_; t<band.tiles; t+=threads_)
+                    rollback_.tile(job_, step, band, t);
+                barrier_.wait();
+                for (Size t=id_; t+1<band.tiles; t+=threads_)
+                    rollback_.gap(job_, step, band, t);
+                barrier_.wait();
+                step -= band.steps;
+            }
+        }
+      private:
+        const BlockedRollback_2<T>& rollback_;
+        Job& job_;
+        Size steps_, id_, threads_;
+        boost::barrier& barrier_;
+    };
+
+
+    template <class T>
+    BlockedRollback_2<T>::BlockedRollback_2(Size threads,
+                                            Size blockSteps,
+                                            Size tileNodes)
+    : threads_(threads), blockSteps_(blockSteps), tileNodes_(tileNodes) {
+        QL_REQUIRE(blockSteps > 0, "at least one step per block required");
+        if (threads_ == 0)
+            threads_ = std::max<Size>(boost::thread::hardware_concurrency(),
+                                      1);
+    }
+
+    template <class T>
+    Array BlockedRollback_2<T>::operator()(const T& tree,
+                                           Size steps,
+                                           DiscountFactor discount,
+                                           const Payoff& payoff,
+                                           Size firstExerciseStep) const {
+        Job job;
+        job.tree = &tree;
+        job.discount = discount;
+        job.payoff = &payoff;
+        job.firstExerciseStep = firstExerciseStep;
+        Real probabilities[T::branches];
+        for (Size b=0; b<Size(T::branches); ++b)
+            probabilities[b] = tree.probability(0, 0, b);
+        job.probabilities = probabilities;
+
+        // as in DiscretizedVanillaOption::reset
+        job.values.resize(tree.size(steps));
+        for (Size j=0; j<job.values.size(); ++j)
+            job.values[j] = std::max(Real(0.0),
+                                     payoff(tree.underlying(steps, j)));
+
+        // tiles are never narrower than this in any block
+        const Size w = T::branches-1;
+        Size maxTiles = tree.size(steps)/std::max(tileNodes_, 3*w) + 1;
+        job.edges.resize(maxTiles*blockSteps_*w);
+
+        Band first = band(tree, steps);
+        Size threads = std::min(threads_, first.tiles);
+        boost::barrier barrier(threads);
+        boost::thread_group workers;
+        for (Size i=1; i<threads; ++i)
+            workers.create_thread(
+                           Worker(*this, job, steps, i, threads, barrier));
+        Worker(*this, job, steps, 0, threads, barrier)();
+        workers.join_all();
+
+        return Array(job.values.begin(),
+                     job.values.begin() + tree.size(0));
+    }
+
+    template <class T>
+    typename BlockedRollback_2<T>::Band
+    BlockedRollback_2<T>::band(const T& tree, Size step) const {
+        const Size w = T::branches-1;
+        Band band;
+        band.steps = std::min(blockSteps_, step);
+        band.nodes = tree.size(step);
+        // wide enough for a tile to keep nodes for its neighbour's gap
+        band.width = std::max(tileNodes_, 2*w*band.steps + w);
+        band.tiles = std::max<Size>(band.nodes/band.width, 1);
+        return band;
+    }
+
+    template <class T>
+    void BlockedRollback_2<T>::tile(Job& job, Size step, const Band& band,
+                                    Size t) const {
+        const Size w = T::branches-1;
+        const Size begin = t*band.width;
+        const Size end = (t+1 == band.tiles ? band.nodes : begin+band.width);
+        Real* v = &job.values[0];
+        Real* edge = t > 0 ? &job.edges[t*blockSteps_*w] : 0;
+        for (Size k=1; k<=band.steps; ++k) {
+            const Size i = step-k;
+            // the first nodes at the previous step are kept for the
+            // gap on the left, as they are about to be overwritten
+            if (edge)
+                std::copy(v+begin, v+begin+w, edge+(k-1)*w);
+            const bool exercise = i >= job.firstExerciseStep;
+            // in place: node j only reads nodes j to j+w
+            for (Size j=begin; j<end-w*k; ++j) {
+                Real x = BlackScholesLattice_2<T>::stepbackNode(
+                                    job.probabilities, v+j, job.discount);
+                if (exercise)
+                    x = std::max(x,
+                                 (*job.payoff)(job.tree->underlying(i, j)));
+                v[j] = x;
+            }
+        }
+    }
+
+    template <class T>
+    void BlockedRollback_2<T>::gap(Job& job, Size step, const Band& band,
+                                   Size t) const {
+        const Size w = T::branches-1;
+        const Size end = (t+1)*band.width;
+        Real* v = &job.values[0];
+        const Real* edge = &job.edges[(t+1)*blockSteps_*w];
+        for (Size k=1; k<=band.steps; ++k) {
+            const Size i = step-k;
+            const bool exercise = i >= job.firstExerciseStep;
+            // nodes before end-w*(k-1) hold the previous step from the
+            // first phase, later ones from the previous pass here
+            for (Size j=end-w*k; j<end; ++j) {
+                Real x;
+                if (j+w < end) {
+                    x = BlackScholesLattice_2<T>::stepbackNode(
+                                    job.probabilities, v+j, job.discount);
+                } else {
+                    Real u[T::branches];
+                    for (Size c=0; c<=w; ++c)
+                        u[c] = j+c < end ? v[j+c] : edge[(k-1)*w+j+c-end];
+                    x = BlackScholesLattice_2<T>::stepbackNode(
+                                       job.probabilities, u, job.discount);
+                }
+                if (exercise)
+                    x = std::max(x,
+                                 (*job.payoff)(job.tree->underlying(i, j)));
+                v[j] = x;
+            }
+        }
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,175 @@
+
+#include "../common/columnarfile.hpp"
+#include "../common/csvtable.hpp"
+#include <ql/utilities/dataparsers.hpp>
+#include <boost/lexical_cast.hpp>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace QuantLib;
+
+/* Converter between CSV and the columnar binary files of
+   columnarfile.hpp.
+
+   usage: bookconverter book.csv book.qlb
+          bookconverter results.qlr results.csv
+
+   The first form converts a book in the CSV format read by
+   batchpricer; if the book has an "underlying" column, the market
+   data of each underlying are taken from its first option and
+   stored once. The file is read twice, first to size the output and
+   then to fill it, so that memory does not depend on the size of
+   the book.
+
+   The second form writes binary results as CSV, with the row number
+   of each option in the book as its id.
+*/
+
+namespace {
+
+    const char* requiredColumns[] = { "type", "strike", "expiry",
+                                      "exercise", "spot", "rate",
+                                      "dividend", "volatility" };
+
+    Real parseReal(const std::vector<std::string>& fields,
+                   const CsvColumns& columns, const std::string& name) {
+        const std::string& field = columns.field(fields, name);
+        try {
+            return boost::lexical_cast<Real>(field);
+        } catch (boost::bad_lexical_cast&) {
+            QL_FAIL("invalid " << name << ": " << field);
+        }
+    }
+
+    void convertBook(const std::string& input, const std::string& output) {
+        std::ifstream in(input.c_str());
+        QL_REQUIRE(in, "cannot open " << input);
+        std::string line;
+        QL_REQUIRE(std::getline(in, line), "missing header line");
+        CsvColumns columns(line);
+        for (Size i=0; i<sizeof(requiredColumns)/sizeof(char*); ++i)
+            columns.require(requiredColumns[i]);
+        bool shared = columns.has("underlying");
+
+        // first pass: count options and underlyings
+        Size rows = 0;
+        std::map<std::string, Size> underlyings;
+        while (std::getline(in, line)) {
+            if (trimCsvField(line).empty())
+                continue;
+            if (shared) {
+                std::string name =
+                    columns.field(splitCsvLine(line), "underlying");
+                if (underlyings.count(name) == 0) {
+                    Size index = underlyings.size();
+                    underlyings[name] = index;
+                }
+            }
+            ++rows;
+        }
+
+        BookFile book(output, rows, shared ? underlyings.size() : rows);
+
+        // second pass: fill the columns
+        in.clear();
+        in.seekg(0);
+        std::getline(in, line);
+        std::vector<bool> filled(book.underlyings(), false);
+        Size row = 0, lineNumber = 1;
+        while (std::getline(in, line)) {
+            ++lineNumber;
+            if (trimCsvField(line).empty())
+                continue;
+            try {
+                std::vector<std::string> fields = splitCsvLine(line);
+                std::string type = columns.field(fields, "type");
+                if (type == "call")
+                    book.types()[row] = Option::Call;
+                else if (type == "put")
+                    book.types()[row] = Option::Put;
+                else
+                    QL_FAIL("unknown option type: " << type);
+                std::string exercise = columns.field(fields, "exercise");
+                if (exercise == "european")
+                    book.exercises()[row] = 0;
+                else if (exercise == "american")
+                    book.exercises()[row] = 1;
+                else
+                    QL_FAIL("unknown exercise: " << exercise);
+                book.strikes()[row] = parseReal(fields, columns, "strike");
+                book.expiries()[row] = boost::int32_t(
+                    DateParser::parseISO(
+                        columns.field(fields, "expiry")).serialNumber());
+                Size u = shared ?
+                    underlyings[columns.field(fields, "underlying")] : row;
+                book.underlyingIndices()[row] = boost::uint32_t(u);
+                if (!filled[u]) {
+                    book.spots()[u] = parseReal(fields, columns, "spot");
+                    book.rates()[u] = parseReal(fields, columns, "rate");
+                    book.dividends()[u] =
+                        parseReal(fields, columns, "dividend");
+                    book.volatilities()[u] =
+                        parseReal(fields, columns, "volatility");
+                    filled[u] = true;
+                }
+            } catch (std::exception& e) {
+                QL_FAIL(input << ", line " << lineNumber << ": "
+                        << e.what());
+            }
+            ++row;
+        }
+        QL_REQUIRE(row == rows, input << " changed during conversion");
+        book.flush();
+    }
+
+    void writeField(std::ostream& out, Real x) {
+        out << ",";
+        if (x == x)  // not NaN
+            out << x;
+    }
+
+    void convertResults(const std::string& input,
+                        const std::string& output) {
+        ResultsFile results(input);
+        std::ofstream out(output.c_str());
+        QL_REQUIRE(out, "cannot open " << output);
+        out << std::setprecision(12);
+        out << "id,npv,delta,gamma,theta,errorEstimate,status\n";
+        for (Size i=0; i<results.rows(); ++i) {
+            out << i;
+            writeField(out, results.npvs()[i]);
+            writeField(out, results.deltas()[i]);
+            writeField(out, results.gammas()[i]);
+            writeField(out, results.thetas()[i]);
+            writeField(out, results.errorEstimates()[i]);
+            out << "," << int(results.statuses()[i]) << "\n";
+        }
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+
+        QL_REQUIRE(argc == 3,
+                   "usage: bookconverter book.csv book.qlb\n"
+                   "       bookconverter results.qlr results.csv");
+        std::string input = argv[1], output = argv[2];
+        if (input.size() >= 4 &&
+            input.compare(input.size()-4, 4, ".qlr") == 0)
+            convertResults(input, output);
+        else
+            convertBook(input, output);
+
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
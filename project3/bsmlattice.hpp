@@ -0,0 +1,276 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file bsmlattice.hpp
+    \brief Black-Scholes lattices for binomial and trinomial trees
+*/
+
+#ifndef bsm_lattice_2_hpp
+#define bsm_lattice_2_hpp
+
+#include <ql/methods/lattices/lattice1d.hpp>
+#include <ql/methods/lattices/lattice.hpp>
+#include <ql/instruments/payoffs.hpp>
+#include <ql/stochasticprocess.hpp>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Simple Black-Scholes lattice on a tree with any number of branches
+    /*! Unlike BlackScholesLattice, which assumes two branches, the
+        number of branches is taken from the tree. As there, the
+        probabilities are assumed to be the same at every node and the
+        descendants of node j to be nodes j, j+1, ..., so that the
+        rollback reduces to a fixed stencil.
+    */
+    template <class T>
+    class BlackScholesLattice_2
+        : public TreeLattice1D<BlackScholesLattice_2<T> > {
+      public:
+        typedef T tree_type;
+        BlackScholesLattice_2(const boost::shared_ptr<T>& tree,
+                              Rate riskFreeRate,
+                              Time end,
+                              Size steps)
+        : TreeLattice1D<BlackScholesLattice_2<T> >(TimeGrid(end, steps),
+                                                   T::branches),
+          tree_(tree), riskFreeRate_(riskFreeRate), dt_(end/steps),
+          discount_(std::exp(-riskFreeRate*dt_)) {
+            for (Size b=0; b<Size(T::branches); ++b)
+                probabilities_[b] = tree->probability(0, 0, b);
+        }
+
+        Rate riskFreeRate() const { return riskFreeRate_; }
+        Time dt() const { return dt_; }
+        Size size(Size i) const { return tree_->size(i); }
+        DiscountFactor discount(Size, Size) const { return discount_; }
+
+        void stepback(Size i, const Array& values, Array& newValues) const {
+            Array::const_iterator v = values.begin();
+            for (Size j=0; j<this->size(i); j++)
+                newValues[j] = stepbackNode(probabilities_, v+j, discount_);
+        }
+        //! value at a node from those of its descendants
+        /*! This is the only place where the rollback arithmetic is
+            written, so that other rollbacks using it give identical
+            results.
+        */
+        static Real stepbackNode(const Real* p, const Real* v,
+                                 DiscountFactor discount) {
+            if (T::branches == 3)
+                return (p[0]*v[0] + p[1]*v[1] + p[2]*v[2])*discount;
+            else
+                // same operations as BlackScholesLattice
+                return (p[0]*v[0] + p[1]*v[1])*discount;
+        }
+        const Real* probabilities() const { return probabilities_; }
+
+        Real underlying(Size i, Size index) const {
+            return tree_->underlying(i, index);
+        }
+        Size descendant(Size i, Size index, Size branch) const {
+            return tree_->descendant(i, index, branch);
+        }
+        Real probability(Size i, Size index, Size branch) const {
+            return tree_->probability(i, index, branch);
+        }
+      protected:
+        boost::shared_ptr<T> tree_;
+        Rate riskFreeRate_;
+        Time dt_;
+        DiscountFactor discount_;
+        Real probabilities_[T::branches];
+    };
+
+
+    //! Black-Scholes lattice keeping only the nodes near the forward
+    /*! At each step, only the nodes within the given number of
+        standard deviations of the forwards of the lowest and highest
+        nodes at t=0, plus one on each side, are stored and rolled
+        back, so that the work grows as \f$ N \sqrt{N} \f$ instead of
+        \f$ N^2 \f$ once the tree is wider than the band. All the
+        nodes at t=0 are kept, and those of a widened tree are thus
+        as accurate as the middle one.
+
+        Descendants falling outside the band take the value of the
+        payoff on the discounted forward, i.e., that of the option at
+        zero volatility, floored by the intrinsic value if the option
+        can be exercised early; with 6 to 8 standard deviations, the
+        error is far below that of the tree.
+
+        As in BlackScholesLattice_2, the probabilities are the same
+        at every node and the descendants of node j are j, j+1, ...;
+        indices are relative to the first node kept at each step, so
+        that descendant() can return indices outside the next band.
+    */
+    template <class T>
+    class TruncatedBlackScholesLattice_2
+        : public TreeLattice1D<TruncatedBlackScholesLattice_2<T> > {
+      public:
+        TruncatedBlackScholesLattice_2(
+                        const boost::shared_ptr<T>& tree,
+                        const boost::shared_ptr<StochasticProcess1D>& process,
+                        Rate riskFreeRate,
+                        Time end,
+                        Size steps,
+                        const boost::shared_ptr<StrikedTypePayoff>& payoff,
+                        bool americanExercise,
+                        Real stdDevs = 7.0);
+
+        Rate riskFreeRate() const { return riskFreeRate_; }
+        Time dt() const { return dt_; }
+        Size size(Size i) const { return sizes_[i]; }
+        DiscountFactor discount(Size, Size) const { return discount_; }
+
+        void stepback(Size i, const Array& values, Array& newValues) const;
+
+        Real underlying(Size i, Size index) const {
+            return tree_->underlying(i, first_[i] + index);
+        }
+        Size descendant(Size i, Size index, Size branch) const {
+            return first_[i] + index + branch - first_[i+1];
+        }
+        Real probability(Size i, Size index, Size branch) const {
+            return tree_->probability(i, first_[i] + index, branch);
+        }
+        //! nodes evaluated by a rollback to t=0
+        Size rolledBackNodes() const;
+      protected:
+        Real boundaryValue(Size i, Size index) const;
+        boost::shared_ptr<T> tree_;
+        Rate riskFreeRate_;
+        Time dt_;
+        DiscountFactor discount_;
+        Real probabilities_[T::branches];
+        Real growth_;
+        boost::shared_ptr<StrikedTypePayoff> payoff_;
+        bool americanExercise_;
+        Size steps_;
+        std::vector<Size> first_, sizes_;
+    };
+
+
+    // template definitions
+
+    template <class T>
+    TruncatedBlackScholesLattice_2<T>::TruncatedBlackScholesLattice_2(
+                        const boost::shared_ptr<T>& tree,
+                        const boost::shared_ptr<StochasticProcess1D>& process,
+                        Rate riskFreeRate,
+                        Time end,
+                        Size steps,
+                        const boost::shared_ptr<StrikedTypePayoff>& payoff,
+                        bool americanExercise,
+                        Real stdDevs)
+    : TreeLattice1D<TruncatedBlackScholesLattice_2<T> >(
+                                       TimeGrid(end, steps), T::branches),
+      tree_(tree), riskFreeRate_(riskFreeRate), dt_(end/steps),
+      discount_(std::exp(-riskFreeRate*dt_)), payoff_(payoff),
+      americanExercise_(americanExercise), steps_(steps),
+      first_(steps+1), sizes_(steps+1) {
+        QL_REQUIRE(stdDevs > 0.0,
+                   "positive number of standard deviations required, "
+                   << stdDevs << " provided");
+        for (Size b=0; b<Size(T::branches); ++b)
+            probabilities_[b] = tree->probability(0, 0, b);
+
+        Real x0 = process->x0();
+        Real drift = process->drift(0.0, x0)*dt_;
+        Real stdDev = process->stdDeviation(0.0, x0, dt_);
+        growth_ = std::exp(drift + 0.5*stdDev*stdDev);
+
+        first_[0] = 0;
+        sizes_[0] = tree->size(0);
+        Real lowest = std::log(tree->underlying(0, 0)),
+             highest = std::log(tree->underlying(0, sizes_[0]-1));
+        for (Size i=1; i<=steps; ++i) {
+            Real width = stdDevs*stdDev*std::sqrt(Real(i));
+            Real low = std::exp(lowest + i*drift - width),
+                 high = std::exp(highest + i*drift + width);
+            // the underlying grows with the index; bisect for the
+            // first node at or above each end of the band
+            Size n = tree->size(i), lo = 0, hi = n;
+            while (lo < hi) {
+                Size mid = (lo+hi)/2;
+                if (tree->underlying(i, mid) < low)
+                    lo = mid+1;
+                else
+                    hi = mid;
+            }
+            Size first = (lo > 0 ? lo-1 : 0);
+            hi = n;
+            while (lo < hi) {
+                Size mid = (lo+hi)/2;
+                if (tree->underlying(i, mid) <= high)
+                    lo = mid+1;
+                else
+                    hi = mid;
+            }
+            Size last = std::min(lo, n-1);
+            first_[i] = first;
+            sizes_[i] = last - first + 1;
+        }
+    }
+
+    template <class T>
+    void TruncatedBlackScholesLattice_2<T>::stepback(
+                        Size i, const Array& values, Array& newValues) const {
+        const Real* p = probabilities_;
+        BigInteger offset = BigInteger(first_[i]) - BigInteger(first_[i+1]);
+        BigInteger next = BigInteger(sizes_[i+1]);
+        for (Size j=0; j<sizes_[i]; j++) {
+            BigInteger k = BigInteger(j) + offset;
+            Real value = 0.0;
+            if (k >= 0 && k+T::branches <= next) {
+                for (Size b=0; b<Size(T::branches); ++b)
+                    value += p[b]*values[k+b];
+            } else {
+                for (Size b=0; b<Size(T::branches); ++b) {
+                    BigInteger kb = k + BigInteger(b);
+                    value += p[b]*(kb >= 0 && kb < next ?
+                                   values[kb] :
+                                   boundaryValue(i+1, first_[i]+j+b));
+                }
+            }
+            newValues[j] = value*discount_;
+        }
+    }
+
+    template <class T>
+    Real TruncatedBlackScholesLattice_2<T>::boundaryValue(
+                                              Size i, Size index) const {
+        Real spot = tree_->underlying(i, index);
+        Real n = Real(steps_ - i);
+        Real value = std::pow(discount_, n) *
+                     (*payoff_)(spot*std::pow(growth_, n));
+        if (americanExercise_)
+            value = std::max(value, (*payoff_)(spot));
+        return value;
+    }
+
+    template <class T>
+    Size TruncatedBlackScholesLattice_2<T>::rolledBackNodes() const {
+        Size nodes = 0;
+        for (Size i=0; i<steps_; ++i)
+            nodes += sizes_[i];
+        return nodes;
+    }
+
+}
+
+
+#endif
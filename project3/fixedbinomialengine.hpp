@@ -0,0 +1,222 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file fixedbinomialengine.hpp
+    \brief Vanilla option pricing on trees with a fixed number of steps
+*/
+
+#ifndef fixed_binomial_engine_hpp
+#define fixed_binomial_engine_hpp
+
+#include <ql/instruments/vanillaoption.hpp>
+#include <ql/pricingengines/greeks.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include "bsmlattice.hpp"
+#include "flatprocess.hpp"
+#include "../common/instrumentation.hpp"
+#include <algorithm>
+
+namespace QuantLib {
+
+    //! Vanilla option pricer on a tree with N steps
+    /*! The number of steps is a template parameter, so that the option
+        values are kept in an array member of the pricer, sized for the
+        last slice, and all loop bounds of the rollback are known to
+        the compiler. The tree is built on the stack at each call, from
+        a FlatBlackScholesProcess_2 owned by the pricer, and rolled
+        back in place as in BinomialVanillaRollback_2, with the
+        arithmetic of BlackScholesLattice_2; once the pricer is built,
+        no memory is allocated.
+
+        The underlying values are obtained by constant ratios between
+        neighbouring nodes and between the first nodes of consecutive
+        steps, as the trees of this project are geometric; the
+        value is thus the one of BinomialVanillaEngine_2 with N steps
+        up to rounding. Trees that make the number of steps odd, such
+        as LeisenReimer_2 and Joshi4_2, require an odd N.
+
+        As it holds the values of the last call, an instance should
+        not be shared among threads.
+    */
+    template <class T, Size N>
+    class FixedBinomialVanillaPricer_2 {
+      public:
+        FixedBinomialVanillaPricer_2();
+        /*! Rolls back the option; early exercise is checked at the
+            steps closest to firstExercise and later, so that a
+            European option has firstExercise = maturity.
+        */
+        void calculate(Option::Type type,
+                       Real strike,
+                       Real spot,
+                       Rate riskFreeRate,
+                       Rate dividendYield,
+                       Volatility volatility,
+                       Time maturity,
+                       Time firstExercise);
+        //! \name Results of the last calculation
+        //@{
+        Real value() const { return value_; }
+        Real delta() const { return delta_; }
+        Real gamma() const { return gamma_; }
+        //@}
+      private:
+        // nodes at step i, with the three at t=0
+        static Size nodes(Size i) { return (T::branches-1)*i + 3; }
+        boost::shared_ptr<FlatBlackScholesProcess_2> process_;
+        Real values_[(T::branches-1)*N + 3];
+        Real value_, delta_, gamma_;
+    };
+
+
+    //! Pricing engine for vanilla options on trees with N steps
+    /*! The option is priced by a FixedBinomialVanillaPricer_2, on the
+        zero rates and volatility at maturity as in
+        BinomialVanillaEngine_2; value, delta, gamma and theta are
+        returned.
+
+        \ingroup vanillaengines
+    */
+    template <class T, Size N>
+    class FixedBinomialVanillaEngine_2 : public VanillaOption::engine {
+      public:
+        explicit FixedBinomialVanillaEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process)
+        : process_(process) {
+            registerWith(process_);
+        }
+        void calculate() const;
+      private:
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        mutable FixedBinomialVanillaPricer_2<T, N> pricer_;
+    };
+
+
+    // template definitions
+
+    template <class T, Size N>
+    FixedBinomialVanillaPricer_2<T, N>::FixedBinomialVanillaPricer_2()
+    : process_(new FlatBlackScholesProcess_2), value_(Null<Real>()),
+      delta_(Null<Real>()), gamma_(Null<Real>()) {
+        QL_REQUIRE(N >= 2, "at least 2 time steps required, "
+                   << N << " provided");
+    }
+
+    template <class T, Size N>
+    void FixedBinomialVanillaPricer_2<T, N>::calculate(
+                                                 Option::Type type,
+                                                 Real strike,
+                                                 Real spot,
+                                                 Rate riskFreeRate,
+                                                 Rate dividendYield,
+                                                 Volatility volatility,
+                                                 Time maturity,
+                                                 Time firstExercise) {
+        QL_REQUIRE(spot > 0.0, "negative or null underlying given");
+        QL_REQUIRE(volatility > 0.0, "negative or null volatility given");
+        QL_REQUIRE(maturity > 0.0, "negative or null maturity given");
+
+        process_->reset(spot, riskFreeRate, dividendYield, volatility);
+        T tree(process_, maturity, N, strike);
+        QL_REQUIRE(tree.columns() == N+1,
+                   "the tree has " << tree.columns()-1 << " steps instead "
+                   "of " << N << "; an odd number is required");
+
+        const Real discount = std::exp(-riskFreeRate*maturity/N);
+        Real p[T::branches];
+        for (Size b=0; b<Size(T::branches); ++b)
+            p[b] = tree.probability(0, 0, b);
+        const Real phi = type == Option::Call ? 1.0 : -1.0;
+        const Size firstExerciseStep = std::min<Size>(
+            Size(std::max(firstExercise, 0.0)/maturity*N + 0.5), N);
+
+        // the ratios between neighbouring nodes, and between the first
+        // nodes of consecutive steps, are the same at every step
+        Real first = tree.underlying(N, 0);
+        const Real ratio = tree.underlying(N, 1)/first;
+        const Real back = tree.underlying(N-1, 0)/first;
+        Real s = first;
+        for (Size j=0; j<nodes(N); ++j) {
+            values_[j] = std::max(phi*(s-strike), 0.0);
+            s *= ratio;
+        }
+
+        // nodes at step i-1 only use values at higher indices
+        for (Size i=N; i>0; --i) {
+            first *= back;
+            if (i-1 >= firstExerciseStep) {
+                s = first;
+                for (Size j=0; j<nodes(i-1); ++j) {
+                    Real value = BlackScholesLattice_2<T>::stepbackNode(
+                                                  p, values_+j, discount);
+                    values_[j] = std::max(value,
+                                          std::max(phi*(s-strike), 0.0));
+                    s *= ratio;
+                }
+            } else {
+                for (Size j=0; j<nodes(i-1); ++j)
+                    values_[j] = BlackScholesLattice_2<T>::stepbackNode(
+                                                  p, values_+j, discount);
+            }
+        }
+
+        // as in BinomialVanillaEngine_2
+        Real s0d = tree.underlying(0, 0);
+        Real s0 = tree.underlying(0, 1);
+        Real s0u = tree.underlying(0, 2);
+        Real h1 = s0-s0d;
+        Real h2 = s0u-s0;
+        value_ = values_[1];
+        delta_ = (-h2)/(h1*(h1+h2))*values_[0]
+               - (h1-h2)/(h1*h2)*values_[1]
+               + h1/(h2*(h1+h2))*values_[2];
+        gamma_ = 2*(h2*values_[0]-(h1+h2)*values_[1]+h1*values_[2])
+               / (h1*h2*(h1+h2));
+    }
+
+
+    template <class T, Size N>
+    void FixedBinomialVanillaEngine_2<T, N>::calculate() const {
+
+        IMT_TRACE_SCOPE("binomial.fixed.calculate");
+
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                                                       arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+        QL_REQUIRE(arguments_.exercise->type() != Exercise::Bermudan,
+                   "Bermudan exercise not supported");
+
+        FlatVanillaData_2 data(*process_, *arguments_.exercise);
+        pricer_.calculate(payoff->optionType(), payoff->strike(),
+                          data.spot, data.riskFreeRate, data.dividendYield,
+                          data.volatility, data.maturity,
+                          data.firstExercise);
+
+        results_.value = pricer_.value();
+        results_.delta = pricer_.delta();
+        results_.gamma = pricer_.gamma();
+        results_.theta = blackScholesTheta(process_,
+                                           results_.value,
+                                           results_.delta,
+                                           results_.gamma);
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,115 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file flatprocess.hpp
+    \brief Black-Scholes process with constant coefficients for trees,
+           and the market data they are built on
+*/
+
+#ifndef flat_black_scholes_process_hpp
+#define flat_black_scholes_process_hpp
+
+#include <ql/exercise.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include <ql/stochasticprocess.hpp>
+#include <cmath>
+
+namespace QuantLib {
+
+    //! Black-Scholes process with constant coefficients
+    /*! As for GeneralizedBlackScholesProcess, x0() is the spot and the
+        drift and diffusion are those of its logarithm. Only what the
+        trees of this project use when they are built is provided, and
+        the coefficients can be changed in place, so that trees can be
+        built on different market data without building any term
+        structure; observers are not notified of the changes.
+    */
+    class FlatBlackScholesProcess_2 : public StochasticProcess1D {
+      public:
+        FlatBlackScholesProcess_2()
+        : x0_(1.0), drift_(0.0), volatility_(0.0) {}
+        void reset(Real spot,
+                   Rate riskFreeRate,
+                   Rate dividendYield,
+                   Volatility volatility) {
+            x0_ = spot;
+            drift_ = riskFreeRate - dividendYield
+                   - 0.5*volatility*volatility;
+            volatility_ = volatility;
+        }
+        Real x0() const { return x0_; }
+        Real drift(Time, Real) const { return drift_; }
+        Real diffusion(Time, Real) const { return volatility_; }
+        Real stdDeviation(Time, Real, Time dt) const {
+            return volatility_*std::sqrt(dt);
+        }
+        Real variance(Time, Real, Time dt) const {
+            return volatility_*volatility_*dt;
+        }
+      private:
+        Real x0_, drift_;
+        Volatility volatility_;
+    };
+
+
+    //! Market data of a vanilla option, flattened at its maturity
+    /*! The rates are the continuous zero rates at maturity on the day
+        counters of their curves, and the volatility is the Black one
+        at maturity and at the spot; times are measured from the
+        reference date of the risk-free curve. These are the data on
+        which the engines of this project build their trees.
+    */
+    struct FlatVanillaData_2 {
+        FlatVanillaData_2(const GeneralizedBlackScholesProcess& process,
+                          const Exercise& exercise);
+        Real spot;
+        Rate riskFreeRate, dividendYield;
+        Volatility volatility;
+        Date referenceDate;
+        Time maturity;
+        //! first exercise time; the maturity unless American
+        Time firstExercise;
+    };
+
+
+    inline FlatVanillaData_2::FlatVanillaData_2(
+                             const GeneralizedBlackScholesProcess& process,
+                             const Exercise& exercise) {
+        DayCounter rfdc  = process.riskFreeRate()->dayCounter();
+        DayCounter divdc = process.dividendYield()->dayCounter();
+        spot = process.stateVariable()->value();
+        QL_REQUIRE(spot > 0.0, "negative or null underlying given");
+        Date maturityDate = exercise.lastDate();
+        volatility = process.blackVolatility()->blackVol(maturityDate,
+                                                         spot);
+        riskFreeRate = process.riskFreeRate()->zeroRate(maturityDate,
+                                                        rfdc, Continuous,
+                                                        NoFrequency);
+        dividendYield = process.dividendYield()->zeroRate(maturityDate,
+                                                          divdc, Continuous,
+                                                          NoFrequency);
+        referenceDate = process.riskFreeRate()->referenceDate();
+        maturity = rfdc.yearFraction(referenceDate, maturityDate);
+        firstExercise = maturity;
+        if (exercise.type() == Exercise::American)
+            firstExercise = process.time(exercise.date(0));
+    }
+
+}
+
+
+#endif
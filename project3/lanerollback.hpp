@@ -0,0 +1,190 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file lanerollback.hpp
+    \brief Vanilla options rolled back together on several trees
+*/
+
+#ifndef lane_rollback_hpp
+#define lane_rollback_hpp
+
+#include <ql/option.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Vanilla options rolled back together, one tree per lane
+    /*! Trees of type T with the same number of steps have the same
+        number of nodes at each step, and the descendants of node j
+        are j, j+1, ..., whatever their market data or strike; the
+        options of Lanes such trees can thus be rolled back together.
+        For each node, the option values of the lanes are followed by
+        the underlying values at the last step, and the innermost loop
+        runs over the lanes, with no dependencies and a fixed length,
+        so that the compiler can vectorize it. Early exercise is
+        checked in the same pass, with European lanes floored at zero
+        instead.
+
+        Only the first nodes of each tree are read: the nodes of a
+        slice are in geometric progression in all the trees of this
+        project, and the first nodes of consecutive slices are in a
+        constant ratio, so that the underlying values at each step are
+        those of the last step, scaled. Apart from that, the
+        arithmetic is the one of BlackScholesLattice_2, so that each
+        value is the one of BinomialVanillaRollback_2 up to rounding.
+
+        The trees are expected to have three nodes at t=0. The buffer
+        is reused across calls; an instance should thus not be shared
+        among threads.
+    */
+    template <class T, Size Lanes>
+    class LaneBinomialRollback_2 {
+      public:
+        LaneBinomialRollback_2() : steps_(0) {}
+        /*! Sets the option of the given lane; early exercise is
+            checked at the steps closest to firstExercise and later, so
+            that a European option has firstExercise = maturity. All
+            lanes must be set, on trees with the same number of steps,
+            before rolling back.
+        */
+        void setLane(Size lane,
+                     const T& tree,
+                     Option::Type type,
+                     Real strike,
+                     Rate riskFreeRate,
+                     Time maturity,
+                     Time firstExercise);
+        /*! Rolls back the options and writes the values at t=0 of the
+            first n lanes to results.
+        */
+        void rollback(Real* results, Size n);
+      private:
+        Size steps_;
+        Real p_[3][Lanes], discount_[Lanes], phi_[Lanes], strike_[Lanes];
+        Real first_[Lanes], ratio_[Lanes], back_[Lanes];
+        Size firstExerciseStep_[Lanes];
+        std::vector<Real> buffer_;
+    };
+
+
+    // template definitions
+
+    template <class T, Size Lanes>
+    void LaneBinomialRollback_2<T, Lanes>::setLane(Size l,
+                                                   const T& tree,
+                                                   Option::Type type,
+                                                   Real strike,
+                                                   Rate riskFreeRate,
+                                                   Time maturity,
+                                                   Time firstExercise) {
+        // some trees adjust the number of steps, but all in the same way
+        Size steps = tree.columns()-1;
+        QL_REQUIRE(l == 0 || steps == steps_,
+                   "tree with " << steps << " steps given for lane " << l
+                   << "; " << steps_ << " expected");
+        steps_ = steps;
+        for (Size b=0; b<Size(T::branches); ++b)
+            p_[b][l] = tree.probability(0, 0, b);
+        discount_[l] = std::exp(-riskFreeRate*maturity/steps);
+        phi_[l] = type == Option::Call ? 1.0 : -1.0;
+        strike_[l] = strike;
+        first_[l] = tree.underlying(steps, 0);
+        ratio_[l] = tree.underlying(steps, 1)/first_[l];
+        back_[l] = tree.underlying(steps-1, 0)/first_[l];
+        firstExerciseStep_[l] = std::min<Size>(
+            Size(std::max(firstExercise, 0.0)/maturity*steps + 0.5),
+            steps);
+    }
+
+    template <class T, Size Lanes>
+    void LaneBinomialRollback_2<T, Lanes>::rollback(Real* results,
+                                                    Size n) {
+        const Size branches = T::branches;
+        const Size steps = steps_;
+        // local copies, which the stores to the buffer can't alias
+        Real p[3][Lanes], discount[Lanes], phi[Lanes], strike[Lanes];
+        Real ratio[Lanes], back[Lanes], s[Lanes];
+        Size firstExerciseStep[Lanes];
+        for (Size l=0; l<Lanes; ++l) {
+            for (Size b=0; b<branches; ++b)
+                p[b][l] = p_[b][l];
+            discount[l] = discount_[l];
+            phi[l] = phi_[l];
+            strike[l] = strike_[l];
+            ratio[l] = ratio_[l];
+            back[l] = back_[l];
+            s[l] = first_[l];
+            firstExerciseStep[l] = firstExerciseStep_[l];
+        }
+
+        // nodes at step i, with the three at t=0
+        const Size nodes = (branches-1)*steps + 3;
+        const Size stride = 2*Lanes;
+        buffer_.resize(nodes*stride);
+        for (Size j=0; j<nodes; ++j) {
+            Real* v = &buffer_[j*stride];
+            for (Size l=0; l<Lanes; ++l) {
+                v[l] = std::max(phi[l]*(s[l]-strike[l]), 0.0);
+                v[Lanes+l] = s[l];
+                s[l] *= ratio[l];
+            }
+        }
+
+        // the underlying values at step i-1 are those at the last
+        // step, scaled by back^(steps-i+1); the scale also includes
+        // the sign of the payoff. Nodes at step i-1 only use values
+        // at higher indices
+        Real scale[Lanes], allowed[Lanes];
+        for (Size l=0; l<Lanes; ++l)
+            scale[l] = phi[l];
+        for (Size i=steps; i>0; --i) {
+            for (Size l=0; l<Lanes; ++l) {
+                scale[l] *= back[l];
+                allowed[l] = i-1 >= firstExerciseStep[l] ? 1.0 : 0.0;
+            }
+            for (Size j=0; j<(branches-1)*(i-1)+3; ++j) {
+                Real* v = &buffer_[j*stride];
+                for (Size l=0; l<Lanes; ++l) {
+                    // same operations as BlackScholesLattice_2
+                    Real value;
+                    if (branches == 3)
+                        value = (p[0][l]*v[l] + p[1][l]*v[stride+l]
+                                 + p[2][l]*v[2*stride+l])*discount[l];
+                    else
+                        value = (p[0][l]*v[l]
+                                 + p[1][l]*v[stride+l])*discount[l];
+                    // values are non-negative, so that a zero floor
+                    // leaves the lanes not exercising unchanged
+                    Real exercise = allowed[l] *
+                        std::max(scale[l]*v[Lanes+l] - phi[l]*strike[l],
+                                 0.0);
+                    v[l] = std::max(value, exercise);
+                }
+            }
+        }
+
+        // middle node at t=0
+        for (Size l=0; l<n; ++l)
+            results[l] = buffer_[stride+l];
+    }
+
+}
+
+
+#endif
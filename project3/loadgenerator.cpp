@@ -0,0 +1,265 @@
+
+#include "../common/pricingprotocol.hpp"
+#include <ql/quantlib.hpp>
+#include <ql/utilities/dataparsers.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+using namespace QuantLib;
+
+/* Load generator for the pricing daemon.
+
+   usage: loadgenerator [options]
+
+   Opens a number of connections to the daemon, each from its own
+   thread, and sends price requests on each of them while keeping a
+   given number in flight; the latency of each request is measured
+   from its sending to the reception of its response. At the end,
+   the latency percentiles and the throughput seen by the clients
+   are printed, followed by the statistics of the server.
+
+   Requests are drawn at random on the given number of underlyings,
+   each with fixed market data, and on a grid of strikes and
+   expiries; fewer strikes give more requests answered from the
+   server's cache.
+
+   options:
+       --socket PATH     socket path; default /tmp/imt-pricing.sock
+       --connections N   concurrent connections; default 4
+       --requests N      requests per connection; default 10000
+       --depth N         requests in flight per connection; default 1
+       --underlyings N   distinct underlyings; default 16
+       --strikes N       distinct strikes per underlying; default 32
+       --exercise NAME   european or american; default european
+       --date D          ISO valuation date of the daemon; default today
+*/
+
+namespace {
+
+    typedef boost::asio::local::stream_protocol protocol;
+
+    struct Configuration {
+        std::string socket;
+        Size connections, requests, depth, underlyings, strikes;
+        bool american;
+        Date valuationDate;
+    };
+
+    long long now() {
+        return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+            boost::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // sends the requests of one connection and times their responses
+    class Client {
+      public:
+        Client(const Configuration& configuration, Size index,
+               std::vector<long long>& latencies, Size& errors)
+        : configuration_(configuration), index_(index),
+          latencies_(latencies), errors_(errors) {}
+        void operator()() const {
+            try {
+                run();
+            } catch (std::exception& e) {
+                std::cerr << "connection " << index_ << ": "
+                          << e.what() << std::endl;
+                latencies_.clear();
+            }
+        }
+      private:
+        void run() const {
+            boost::asio::io_service service;
+            protocol::socket socket(service);
+            socket.connect(protocol::endpoint(configuration_.socket));
+
+            Size n = configuration_.requests;
+            MersenneTwisterUniformRng rng(42 + index_);
+            std::vector<long long> sent(n);
+            latencies_.resize(n);
+            errors_ = 0;
+            Size next = 0;
+            for (; next < std::min(configuration_.depth, n); ++next)
+                send(socket, rng, next, sent);
+            for (Size received=0; received<n; ++received) {
+                PricingResponseFrame response;
+                boost::asio::read(socket,
+                                  boost::asio::buffer(&response,
+                                                      sizeof(response)));
+                Size k = Size(response.id % n);
+                latencies_[k] = now() - sent[k];
+                if (response.status != PricingMessage::Ok)
+                    ++errors_;
+                if (next < n)
+                    send(socket, rng, next++, sent);
+            }
+        }
+        void send(protocol::socket& socket,
+                  const MersenneTwisterUniformRng& rng,
+                  Size k, std::vector<long long>& sent) const {
+            PricingRequestFrame request;
+            std::fill(reinterpret_cast<char*>(&request),
+                      reinterpret_cast<char*>(&request) + sizeof(request),
+                      0);
+            Size u = draw(rng, configuration_.underlyings);
+            request.kind = PricingMessage::Price;
+            request.underlying = boost::uint32_t(u);
+            request.id = boost::uint64_t(index_)*configuration_.requests+k;
+            request.spot = 100.0;
+            request.rate = 0.05;
+            request.dividend = 0.02;
+            request.volatility = 0.15 + 0.01*(u % 16);
+            Size strikes = configuration_.strikes;
+            request.strike = strikes > 1 ?
+                80.0 + 40.0*draw(rng, strikes)/(strikes-1) : 100.0;
+            request.expiry = (configuration_.valuationDate +
+                              Period(3*(1+draw(rng, 8)), Months))
+                             .serialNumber();
+            request.type = draw(rng, 2) == 0 ? 1 : -1;
+            request.exercise = configuration_.american ? 1 : 0;
+            sent[k] = now();
+            boost::asio::write(socket,
+                               boost::asio::buffer(&request,
+                                                   sizeof(request)));
+        }
+        static Size draw(const MersenneTwisterUniformRng& rng, Size n) {
+            return std::min(Size(rng.next().value*n), n-1);
+        }
+        const Configuration& configuration_;
+        Size index_;
+        std::vector<long long>& latencies_;
+        Size& errors_;
+    };
+
+    PricingResponseFrame query(const Configuration& configuration,
+                               PricingMessage::Kind kind) {
+        boost::asio::io_service service;
+        protocol::socket socket(service);
+        socket.connect(protocol::endpoint(configuration.socket));
+        PricingRequestFrame request;
+        std::fill(reinterpret_cast<char*>(&request),
+                  reinterpret_cast<char*>(&request) + sizeof(request), 0);
+        request.kind = kind;
+        boost::asio::write(socket,
+                           boost::asio::buffer(&request, sizeof(request)));
+        PricingResponseFrame response;
+        boost::asio::read(socket,
+                          boost::asio::buffer(&response, sizeof(response)));
+        return response;
+    }
+
+    Real percentile(std::vector<long long>& latencies, Real q) {
+        std::vector<long long>::iterator i =
+            latencies.begin() + Size(q*(latencies.size()-1));
+        std::nth_element(latencies.begin(), i, latencies.end());
+        return *i * 1.0e-3;
+    }
+
+    Size parseSize(const std::string& option, const std::string& value) {
+        try {
+            return boost::lexical_cast<Size>(value);
+        } catch (boost::bad_lexical_cast&) {
+            QL_FAIL("invalid value for " << option << ": " << value);
+        }
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+
+        Configuration configuration;
+        configuration.socket = "/tmp/imt-pricing.sock";
+        configuration.connections = 4;
+        configuration.requests = 10000;
+        configuration.depth = 1;
+        configuration.underlyings = 16;
+        configuration.strikes = 32;
+        configuration.american = false;
+        configuration.valuationDate = Date::todaysDate();
+
+        for (int i=1; i<argc; ++i) {
+            std::string option = argv[i];
+            QL_REQUIRE(i+1 < argc, "missing value for " << option);
+            std::string value = argv[++i];
+            if (option == "--socket")
+                configuration.socket = value;
+            else if (option == "--connections")
+                configuration.connections = parseSize(option, value);
+            else if (option == "--requests")
+                configuration.requests = parseSize(option, value);
+            else if (option == "--depth")
+                configuration.depth = parseSize(option, value);
+            else if (option == "--underlyings")
+                configuration.underlyings = parseSize(option, value);
+            else if (option == "--strikes")
+                configuration.strikes = parseSize(option, value);
+            else if (option == "--exercise")
+                configuration.american = (value == "american");
+            else if (option == "--date")
+                configuration.valuationDate = DateParser::parseISO(value);
+            else
+                QL_FAIL("unknown option: " << option);
+        }
+        QL_REQUIRE(configuration.connections > 0 &&
+                   configuration.requests > 0 &&
+                   configuration.depth > 0 &&
+                   configuration.underlyings > 0 &&
+                   configuration.strikes > 0,
+                   "all counts must be positive");
+
+        std::vector<std::vector<long long> > latencies(
+                                                configuration.connections);
+        std::vector<Size> errors(configuration.connections);
+        long long start = now();
+        boost::thread_group clients;
+        for (Size i=0; i<configuration.connections; ++i)
+            clients.create_thread(
+                   Client(configuration, i, latencies[i], errors[i]));
+        clients.join_all();
+        Real elapsed = (now() - start) * 1.0e-9;
+
+        std::vector<long long> all;
+        Size failed = 0;
+        for (Size i=0; i<configuration.connections; ++i) {
+            all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+            failed += errors[i];
+        }
+
+        QL_REQUIRE(!all.empty(), "no request completed");
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << all.size() << " requests in " << elapsed << " s, "
+                  << all.size()/elapsed << " per second, "
+                  << failed << " failed" << std::endl;
+        std::cout << "latency (us): p50 " << percentile(all, 0.50)
+                  << ", p90 " << percentile(all, 0.90)
+                  << ", p99 " << percentile(all, 0.99)
+                  << ", max " << percentile(all, 1.0) << std::endl;
+
+        PricingResponseFrame statistics =
+            query(configuration, PricingMessage::Statistics);
+        std::cout << "server: " << statistics.values[0] << " requests, "
+                  << statistics.values[2] << " batches, "
+                  << statistics.values[3] << " from cache, "
+                  << "p50 " << statistics.values[4]*1.0e6 << " us, "
+                  << "p99 " << statistics.values[5]*1.0e6 << " us"
+                  << std::endl;
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,196 @@
+
+#include "binomialtree.hpp"
+#include "binomialengine.hpp"
+#include "../project1/mceuropeanengine.hpp"
+#include "../project1/mcrandomcache.hpp"
+#include "../common/pricingserver.hpp"
+#include <ql/quantlib.hpp>
+#include <ql/utilities/dataparsers.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <iostream>
+#include <signal.h>
+
+using namespace QuantLib;
+
+/* Resident pricing server for vanilla options.
+
+   usage: pricingdaemon [options]
+
+   Listens on a Unix domain socket for the requests described in
+   common/pricingprotocol.hpp and prices them until it gets SIGINT
+   or SIGTERM, after which it prints its statistics. Market objects,
+   engines and results are kept per underlying between requests
+   (see common/pricingserver.hpp); the Monte Carlo engine also
+   replays its random numbers from a cache, so that only the first
+   request with given steps pays for their generation.
+
+   options:
+       --socket PATH  socket path; default /tmp/imt-pricing.sock
+       --engine NAME  jr, crr, eqp, trigeorgis, tian, lr, joshi4
+                      (BinomialVanillaEngine_2 on the given tree)
+                      or mc (MCEuropeanEngine_2); default crr
+       --steps N      tree or path steps; default 500 for trees, 1 for mc
+       --samples N    Monte Carlo samples; default 100000
+       --seed N       Monte Carlo seed; default 42
+       --threads N    worker threads; default one per core
+       --date D       ISO valuation date; default today
+*/
+
+namespace {
+
+    struct Configuration {
+        std::string socket, engine;
+        Size steps, samples, threads;
+        BigNatural seed;
+        Date valuationDate;
+    };
+
+    template <class T>
+    boost::shared_ptr<PricingEngine> treeEngine(
+               const boost::shared_ptr<GeneralizedBlackScholesProcess>& p,
+               const Configuration& configuration) {
+        return boost::shared_ptr<PricingEngine>(
+                  new BinomialVanillaEngine_2<T>(p, configuration.steps));
+    }
+
+    boost::shared_ptr<PricingEngine> mcEngine(
+               const boost::shared_ptr<GeneralizedBlackScholesProcess>& p,
+               const Configuration& configuration) {
+        return MakeMCEuropeanEngine_2<CachedRandom<PseudoRandom> >(p)
+            .withSteps(configuration.steps)
+            .withSamples(configuration.samples)
+            .withSeed(configuration.seed)
+            .withGreeks();
+    }
+
+    PricingServer::EngineFactory engineFactory(
+                                      const Configuration& configuration) {
+        const std::string& name = configuration.engine;
+        if (name == "jr")
+            return boost::bind(&treeEngine<JarrowRudd_2>, _1,
+                               configuration);
+        else if (name == "crr")
+            return boost::bind(&treeEngine<CoxRossRubinstein_2>, _1,
+                               configuration);
+        else if (name == "eqp")
+            return boost::bind(&treeEngine<AdditiveEQPBinomialTree_2>, _1,
+                               configuration);
+        else if (name == "trigeorgis")
+            return boost::bind(&treeEngine<Trigeorgis_2>, _1,
+                               configuration);
+        else if (name == "tian")
+            return boost::bind(&treeEngine<Tian_2>, _1, configuration);
+        else if (name == "lr")
+            return boost::bind(&treeEngine<LeisenReimer_2>, _1,
+                               configuration);
+        else if (name == "joshi4")
+            return boost::bind(&treeEngine<Joshi4_2>, _1, configuration);
+        else if (name == "mc")
+            return boost::bind(&mcEngine, _1, configuration);
+        else
+            QL_FAIL("unknown engine: " << name);
+    }
+
+    // waits for the given signals and stops the server
+    class SignalHandler {
+      public:
+        SignalHandler(PricingServer& server, const sigset_t& signals)
+        : server_(server), signals_(signals) {}
+        void operator()() const {
+            int signal;
+            sigwait(&signals_, &signal);
+            server_.stop();
+        }
+      private:
+        PricingServer& server_;
+        sigset_t signals_;
+    };
+
+    Size parseSize(const std::string& option, const std::string& value) {
+        try {
+            return boost::lexical_cast<Size>(value);
+        } catch (boost::bad_lexical_cast&) {
+            QL_FAIL("invalid value for " << option << ": " << value);
+        }
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+
+    try {
+
+        Configuration configuration;
+        configuration.socket = "/tmp/imt-pricing.sock";
+        configuration.engine = "crr";
+        configuration.steps = Null<Size>();
+        configuration.samples = 100000;
+        configuration.seed = 42;
+        configuration.threads = boost::thread::hardware_concurrency();
+        configuration.valuationDate = Date::todaysDate();
+
+        for (int i=1; i<argc; ++i) {
+            std::string option = argv[i];
+            QL_REQUIRE(i+1 < argc, "missing value for " << option);
+            std::string value = argv[++i];
+            if (option == "--socket")
+                configuration.socket = value;
+            else if (option == "--engine")
+                configuration.engine = value;
+            else if (option == "--steps")
+                configuration.steps = parseSize(option, value);
+            else if (option == "--samples")
+                configuration.samples = parseSize(option, value);
+            else if (option == "--seed")
+                configuration.seed = parseSize(option, value);
+            else if (option == "--threads")
+                configuration.threads = parseSize(option, value);
+            else if (option == "--date")
+                configuration.valuationDate = DateParser::parseISO(value);
+            else
+                QL_FAIL("unknown option: " << option);
+        }
+        if (configuration.threads == 0)
+            configuration.threads = 1;
+        if (configuration.steps == Null<Size>())
+            configuration.steps = (configuration.engine == "mc" ? 1 : 500);
+        PricingServer::EngineFactory factory = engineFactory(configuration);
+
+        // set once, before any worker starts, and only read afterwards
+        Settings::instance().evaluationDate() = configuration.valuationDate;
+        // built here as well, rather than by the first workers at once
+        RandomSequenceCache<PseudoRandom>::instance();
+
+        // blocked before any thread starts, so that only the handler
+        // gets them
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, 0);
+
+        PricingServer server(configuration.socket, factory,
+                             configuration.valuationDate,
+                             configuration.threads);
+        boost::thread handler(SignalHandler(server, signals));
+        std::cerr << "listening on " << configuration.socket << std::endl;
+        server.run();
+        handler.join();
+
+        PricingServerStatistics statistics = server.statistics();
+        std::cerr << statistics.requests << " requests, "
+                  << statistics.errors << " failed, "
+                  << statistics.batches << " batches, "
+                  << statistics.cacheHits << " from cache" << std::endl;
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,195 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file scenariorollback.hpp
+    \brief Vanilla option values under many market scenarios in one
+           rollback
+*/
+
+#ifndef scenario_rollback_hpp
+#define scenario_rollback_hpp
+
+#include <ql/instruments/vanillaoption.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include "flatprocess.hpp"
+#include "lanerollback.hpp"
+#include "../common/instrumentation.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Shift of the market data of a vanilla option
+    struct RiskScenario_2 {
+        RiskScenario_2(Real spotShift = 0.0,
+                       Volatility volatilityShift = 0.0,
+                       Spread rateShift = 0.0)
+        : spotShift(spotShift), volatilityShift(volatilityShift),
+          rateShift(rateShift) {}
+        //! relative, i.e., the spot is multiplied by 1+spotShift
+        Real spotShift;
+        //! absolute, added to the volatility
+        Volatility volatilityShift;
+        //! absolute, added to the continuous risk-free rate
+        Spread rateShift;
+    };
+
+
+    //! Vanilla option rolled back under several scenarios at once
+    /*! Each scenario has its own tree of type T, built on its shifted
+        market data through a FlatBlackScholesProcess_2; the scenarios
+        are taken in groups of Lanes, and the trees of each group are
+        rolled back together by a LaneBinomialRollback_2, so that each
+        value is the one of BinomialVanillaRollback_2 on the shifted
+        data up to rounding.
+
+        The process and the buffer are reused across calls; an
+        instance should thus not be shared among threads.
+    */
+    template <class T, Size Lanes = 4>
+    class ScenarioBinomialRollback_2 {
+      public:
+        ScenarioBinomialRollback_2()
+        : process_(new FlatBlackScholesProcess_2) {}
+        /*! Returns the option values at t=0 for each scenario; early
+            exercise is checked at the steps closest to firstExercise
+            and later, so that a European option has
+            firstExercise = maturity.
+        */
+        std::vector<Real> operator()(
+                           Real spot,
+                           Rate riskFreeRate,
+                           Rate dividendYield,
+                           Volatility volatility,
+                           const PlainVanillaPayoff& payoff,
+                           Time maturity,
+                           Time firstExercise,
+                           Size timeSteps,
+                           const std::vector<RiskScenario_2>& scenarios);
+      private:
+        boost::shared_ptr<FlatBlackScholesProcess_2> process_;
+        LaneBinomialRollback_2<T, Lanes> lanes_;
+    };
+
+
+    //! Pricing engine for vanilla options under a set of scenarios
+    /*! The option is valued on the current market data and under each
+        of the given scenarios by a single ScenarioBinomialRollback_2;
+        the value for the current data is returned as the NPV, and
+        those for the scenarios are stored in the additional results
+        as "scenarioNPVs", in the order of the scenarios.
+
+        As in BinomialVanillaEngine_2, the trees are built on the
+        zero rates and volatility at maturity; no greeks are given.
+
+        \ingroup vanillaengines
+    */
+    template <class T, Size Lanes = 4>
+    class ScenarioBinomialVanillaEngine_2 : public VanillaOption::engine {
+      public:
+        ScenarioBinomialVanillaEngine_2(
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>& process,
+             Size timeSteps,
+             const std::vector<RiskScenario_2>& scenarios)
+        : process_(process), timeSteps_(timeSteps), scenarios_(scenarios) {
+            QL_REQUIRE(timeSteps >= 2,
+                       "at least 2 time steps required, "
+                       << timeSteps << " provided");
+            registerWith(process_);
+        }
+        void calculate() const;
+      private:
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process_;
+        Size timeSteps_;
+        std::vector<RiskScenario_2> scenarios_;
+        mutable ScenarioBinomialRollback_2<T, Lanes> rollback_;
+    };
+
+
+    // template definitions
+
+    template <class T, Size Lanes>
+    std::vector<Real> ScenarioBinomialRollback_2<T, Lanes>::operator()(
+                           Real spot,
+                           Rate riskFreeRate,
+                           Rate dividendYield,
+                           Volatility volatility,
+                           const PlainVanillaPayoff& payoff,
+                           Time maturity,
+                           Time firstExercise,
+                           Size timeSteps,
+                           const std::vector<RiskScenario_2>& scenarios) {
+        const Real strike = payoff.strike();
+        std::vector<Real> results(scenarios.size());
+        for (Size first=0; first<scenarios.size(); first+=Lanes) {
+            // the last group is padded with its last scenario
+            for (Size l=0; l<Lanes; ++l) {
+                Size k = std::min(first+l, scenarios.size()-1);
+                const RiskScenario_2& scenario = scenarios[k];
+                Real s = spot*(1.0+scenario.spotShift);
+                Rate r = riskFreeRate + scenario.rateShift;
+                Volatility v = volatility + scenario.volatilityShift;
+                QL_REQUIRE(s > 0.0 && v > 0.0,
+                           "non-positive spot (" << s << ") or volatility ("
+                           << v << ") in scenario " << k);
+                process_->reset(s, r, dividendYield, v);
+                T tree(process_, maturity, timeSteps, strike);
+                lanes_.setLane(l, tree, payoff.optionType(), strike, r,
+                               maturity, firstExercise);
+            }
+            lanes_.rollback(&results[first],
+                            std::min(Lanes, scenarios.size()-first));
+        }
+        return results;
+    }
+
+
+    template <class T, Size Lanes>
+    void ScenarioBinomialVanillaEngine_2<T, Lanes>::calculate() const {
+
+        IMT_TRACE_SCOPE("binomial.scenarios.calculate");
+
+        boost::shared_ptr<PlainVanillaPayoff> payoff =
+            boost::dynamic_pointer_cast<PlainVanillaPayoff>(
+                                                       arguments_.payoff);
+        QL_REQUIRE(payoff, "non-plain payoff given");
+        QL_REQUIRE(arguments_.exercise->type() != Exercise::Bermudan,
+                   "Bermudan exercise not supported");
+
+        FlatVanillaData_2 data(*process_, *arguments_.exercise);
+
+        // the current market data go first
+        std::vector<RiskScenario_2> scenarios(1);
+        scenarios.insert(scenarios.end(),
+                         scenarios_.begin(), scenarios_.end());
+        std::vector<Real> values = rollback_(data.spot, data.riskFreeRate,
+                                             data.dividendYield,
+                                             data.volatility, *payoff,
+                                             data.maturity,
+                                             data.firstExercise,
+                                             timeSteps_, scenarios);
+        IMT_COUNT("binomial.scenarios", scenarios.size());
+
+        results_.value = values[0];
+        results_.additionalResults["scenarioNPVs"] =
+            std::vector<Real>(values.begin()+1, values.end());
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,154 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file stateprices.hpp
+    \brief Arrow-Debreu state prices on a lattice by forward induction
+*/
+
+#ifndef state_prices_2_hpp
+#define state_prices_2_hpp
+
+#include <ql/instruments/payoffs.hpp>
+#include <ql/math/array.hpp>
+#include <ql/timegrid.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Arrow-Debreu state prices of a lattice at given expiries
+    /*! The state price of a node is the value today of a unit paid
+        if and only if that node is reached. They are propagated
+        forward from the spot node, i.e., the middle one at t=0, where
+        it's 1, with
+        \f[ Q_{i+1,k} = \sum_{(j,b) \to k} Q_{i,j} \, p_{i,j,b} \,
+            d_{i,j} \f]
+        over the branches b from node j at step i leading to node k,
+        using the probabilities and discount factors of the lattice;
+        this is the transpose of the rollback, so that the value of a
+        European payoff is the same as that rolled back from its
+        expiry, up to rounding.
+
+        A single pass up to the last expiry costs as much as one
+        rollback; the slices at the given expiries are kept, after
+        which each European payoff at one of them costs a sum over
+        the nodes of its slice. Each expiry is moved to the closest
+        step of the lattice grid, which should therefore be fine
+        enough or include the expiries.
+
+        The lattice can be any one-dimensional tree lattice exposing
+        its tree type, e.g., BlackScholesLattice_2 on the trees of
+        this project or ExtendedBlackScholesLattice_2 on those of
+        project 2.
+    */
+    template <class L>
+    class StatePrices_2 {
+      public:
+        StatePrices_2(const L& lattice, const std::vector<Time>& expiries);
+        //! \name Inspectors
+        //@{
+        Size slices() const { return steps_.size(); }
+        //! step of the k-th slice, in increasing order
+        Size step(Size k) const { return steps_[k]; }
+        //! slice of the step closest to the given expiry
+        Size slice(Time expiry) const;
+        //! state prices of the nodes of the k-th slice
+        const Array& prices(Size k) const { return prices_[k]; }
+        //! underlying values of the nodes of the k-th slice
+        const Array& underlyings(Size k) const { return underlyings_[k]; }
+        //@}
+        //! value today of the payoff paid at the k-th slice
+        Real value(const Payoff& payoff, Size k) const;
+        //! value today of the payoff paid at the given expiry
+        Real value(const Payoff& payoff, Time expiry) const {
+            return value(payoff, slice(expiry));
+        }
+      private:
+        TimeGrid grid_;
+        std::vector<Size> steps_;
+        std::vector<Array> prices_, underlyings_;
+    };
+
+
+    // template definitions
+
+    template <class L>
+    StatePrices_2<L>::StatePrices_2(const L& lattice,
+                                    const std::vector<Time>& expiries)
+    : grid_(lattice.timeGrid()) {
+        QL_REQUIRE(!expiries.empty(), "no expiries given");
+        for (Size k=0; k<expiries.size(); ++k) {
+            QL_REQUIRE(expiries[k] >= 0.0 &&
+                       expiries[k] <= grid_.back() + 1.0e-12,
+                       "expiry " << expiries[k] << " outside the "
+                       "lattice, which ends at " << grid_.back());
+            steps_.push_back(grid_.closestIndex(expiries[k]));
+        }
+        std::sort(steps_.begin(), steps_.end());
+        steps_.erase(std::unique(steps_.begin(), steps_.end()),
+                     steps_.end());
+
+        // the spot is the middle node at t=0
+        Array current(lattice.size(0), 0.0), next;
+        current[(lattice.size(0)-1)/2] = 1.0;
+        Size k = 0;
+        for (Size i=0; ; ++i) {
+            if (i == steps_[k]) {
+                prices_.push_back(current);
+                Array s(lattice.size(i));
+                for (Size j=0; j<s.size(); ++j)
+                    s[j] = lattice.underlying(i, j);
+                underlyings_.push_back(s);
+                if (++k == steps_.size())
+                    break;
+            }
+            next = Array(lattice.size(i+1), 0.0);
+            for (Size j=0; j<current.size(); ++j) {
+                Real q = current[j] * lattice.discount(i, j);
+                for (Size b=0; b<Size(L::tree_type::branches); ++b)
+                    next[lattice.descendant(i, j, b)] +=
+                        q * lattice.probability(i, j, b);
+            }
+            current.swap(next);
+        }
+    }
+
+    template <class L>
+    Size StatePrices_2<L>::slice(Time expiry) const {
+        Size i = grid_.closestIndex(expiry);
+        std::vector<Size>::const_iterator k =
+            std::lower_bound(steps_.begin(), steps_.end(), i);
+        QL_REQUIRE(k != steps_.end() && *k == i,
+                   "no state prices at t = " << expiry);
+        return k - steps_.begin();
+    }
+
+    template <class L>
+    Real StatePrices_2<L>::value(const Payoff& payoff, Size k) const {
+        QL_REQUIRE(k < slices(), "slice " << k << " out of range");
+        const Array& q = prices_[k];
+        const Array& s = underlyings_[k];
+        Real sum = 0.0;
+        for (Size j=0; j<q.size(); ++j)
+            sum += q[j] * payoff(s[j]);
+        return sum;
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,276 @@
+
+#include "binomialtree.hpp"
+#include "binomialengine.hpp"
+#include "../project2/extendedbinomialtree.hpp"
+#include <ql/quantlib.hpp>
+#include <boost/chrono.hpp>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+using namespace QuantLib;
+
+/* Accuracy-versus-cost benchmark of the binomial trees.
+
+   Every tree is run with increasing numbers of steps on a grid of
+   moneyness, maturity and volatility. For each option class, the
+   errors against a reference price are summarized as root mean
+   square and maximum over the grid, and the cost as mean wall time
+   per option. The output lists all the results, then the Pareto
+   frontier of RMS error versus cost for each class, i.e., the
+   cheapest tree and step count for each accuracy requirement.
+
+   The reference is the analytic formula for European options and
+   a Leisen-Reimer tree with referenceSteps steps for American ones.
+*/
+
+namespace {
+
+    typedef boost::shared_ptr<PricingEngine> (*EngineFactory)(
+                  const boost::shared_ptr<GeneralizedBlackScholesProcess>&,
+                  Size);
+
+    // trees of project3, with three nodes at t=0
+    template <class T>
+    boost::shared_ptr<PricingEngine> treeEngine(
+               const boost::shared_ptr<GeneralizedBlackScholesProcess>& p,
+               Size steps) {
+        return boost::shared_ptr<PricingEngine>(
+                                   new BinomialVanillaEngine_2<T>(p, steps));
+    }
+
+    // time-dependent trees of project2
+    template <class T>
+    boost::shared_ptr<PricingEngine> extendedTreeEngine(
+               const boost::shared_ptr<GeneralizedBlackScholesProcess>& p,
+               Size steps) {
+        return boost::shared_ptr<PricingEngine>(
+                                    new BinomialVanillaEngine<T>(p, steps));
+    }
+
+    struct TreeType {
+        std::string name;
+        EngineFactory factory;
+    };
+
+    struct OptionClass {
+        std::string name;
+        Option::Type type;
+        bool american;
+    };
+
+    struct Scenario {
+        Real moneyness;
+        Time maturity;
+        Volatility volatility;
+    };
+
+    struct Result {
+        std::string tree;
+        Size steps;
+        Real rmsError, maxError, cost;
+    };
+
+    // orders by cost, then error, so that the frontier is a single scan
+    bool cheaper(const Result& a, const Result& b) {
+        if (a.cost != b.cost)
+            return a.cost < b.cost;
+        return a.rmsError < b.rmsError;
+    }
+
+    template <class T, Size N>
+    Size length(const T (&)[N]) {
+        return N;
+    }
+
+    Real seconds(const boost::chrono::steady_clock::time_point& start) {
+        return boost::chrono::duration<Real>(
+                       boost::chrono::steady_clock::now() - start).count();
+    }
+
+}
+
+int main() {
+
+    try {
+
+        const Size referenceSteps = 10001;
+        const Real spot = 100.0;
+        const Rate riskFreeRate = 0.03;
+        const Rate dividendYield = 0.02;
+
+        const Real moneyness[] = { 0.8, 0.9, 1.0, 1.1, 1.2 };
+        const Time maturities[] = { 0.25, 1.0, 3.0 };
+        const Volatility volatilities[] = { 0.1, 0.2, 0.4 };
+        const Size steps[] = { 25, 50, 100, 200, 400, 800, 1600 };
+
+        const TreeType trees[] = {
+            { "JarrowRudd_2", &treeEngine<JarrowRudd_2> },
+            { "CoxRossRubinstein_2", &treeEngine<CoxRossRubinstein_2> },
+            { "AdditiveEQPBinomialTree_2",
+              &treeEngine<AdditiveEQPBinomialTree_2> },
+            { "Trigeorgis_2", &treeEngine<Trigeorgis_2> },
+            { "Tian_2", &treeEngine<Tian_2> },
+            { "LeisenReimer_2", &treeEngine<LeisenReimer_2> },
+            { "Joshi4_2", &treeEngine<Joshi4_2> },
+            { "ExtendedJarrowRudd_2",
+              &extendedTreeEngine<ExtendedJarrowRudd_2> },
+            { "ExtendedCoxRossRubinstein_2",
+              &extendedTreeEngine<ExtendedCoxRossRubinstein_2> },
+            { "ExtendedAdditiveEQPBinomialTree_2",
+              &extendedTreeEngine<ExtendedAdditiveEQPBinomialTree_2> },
+            { "ExtendedTrigeorgis_2",
+              &extendedTreeEngine<ExtendedTrigeorgis_2> },
+            { "ExtendedTian_2", &extendedTreeEngine<ExtendedTian_2> },
+            { "ExtendedLeisenReimer_2",
+              &extendedTreeEngine<ExtendedLeisenReimer_2> },
+            { "ExtendedJoshi4_2", &extendedTreeEngine<ExtendedJoshi4_2> }
+        };
+
+        const OptionClass classes[] = {
+            { "EuropeanCall", Option::Call, false },
+            { "EuropeanPut", Option::Put, false },
+            { "AmericanPut", Option::Put, true }
+        };
+
+        Date today(6, January, 2017);
+        Settings::instance().evaluationDate() = today;
+        DayCounter dayCounter = Actual365Fixed();
+        Calendar calendar = TARGET();
+
+        Handle<Quote> underlying(
+            boost::shared_ptr<Quote>(new SimpleQuote(spot)));
+        Handle<YieldTermStructure> riskFree(
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(today, riskFreeRate, dayCounter)));
+        Handle<YieldTermStructure> dividends(
+            boost::shared_ptr<YieldTermStructure>(
+                new FlatForward(today, dividendYield, dayCounter)));
+        boost::shared_ptr<SimpleQuote> volatility(new SimpleQuote(0.2));
+        Handle<BlackVolTermStructure> volTS(
+            boost::shared_ptr<BlackVolTermStructure>(
+                new BlackConstantVol(today, calendar,
+                                     Handle<Quote>(volatility),
+                                     dayCounter)));
+        boost::shared_ptr<GeneralizedBlackScholesProcess> process(
+            new BlackScholesMertonProcess(underlying, dividends,
+                                          riskFree, volTS));
+
+        std::vector<Scenario> scenarios;
+        for (Size i=0; i<length(moneyness); ++i) {
+            for (Size j=0; j<length(maturities); ++j) {
+                for (Size k=0; k<length(volatilities); ++k) {
+                    Scenario s = { moneyness[i], maturities[j],
+                                   volatilities[k] };
+                    scenarios.push_back(s);
+                }
+            }
+        }
+
+        std::cout << "class,tree,steps,rmsError,maxError,microseconds"
+                  << std::endl;
+
+        for (Size c=0; c<length(classes); ++c) {
+            const OptionClass& optionClass = classes[c];
+
+            // options and reference prices of the scenarios
+            std::vector<boost::shared_ptr<VanillaOption> > options;
+            std::vector<Real> references;
+            for (Size s=0; s<scenarios.size(); ++s) {
+                Date maturity = today + Integer(
+                                   scenarios[s].maturity*365.0 + 0.5);
+                boost::shared_ptr<Exercise> exercise;
+                if (optionClass.american)
+                    exercise = boost::shared_ptr<Exercise>(
+                                  new AmericanExercise(today, maturity));
+                else
+                    exercise = boost::shared_ptr<Exercise>(
+                                          new EuropeanExercise(maturity));
+                boost::shared_ptr<VanillaOption> option(new VanillaOption(
+                    boost::shared_ptr<StrikedTypePayoff>(
+                        new PlainVanillaPayoff(
+                                  optionClass.type,
+                                  spot*scenarios[s].moneyness)),
+                    exercise));
+
+                volatility->setValue(scenarios[s].volatility);
+                if (optionClass.american)
+                    option->setPricingEngine(
+                        treeEngine<LeisenReimer_2>(process, referenceSteps));
+                else
+                    option->setPricingEngine(
+                        boost::shared_ptr<PricingEngine>(
+                                      new AnalyticEuropeanEngine(process)));
+                references.push_back(option->NPV());
+                options.push_back(option);
+            }
+
+            std::vector<Result> results;
+            for (Size t=0; t<length(trees); ++t) {
+                for (Size n=0; n<length(steps); ++n) {
+                    boost::shared_ptr<PricingEngine> engine =
+                        trees[t].factory(process, steps[n]);
+                    Real sumOfSquares = 0.0, maxError = 0.0, elapsed = 0.0;
+                    for (Size s=0; s<scenarios.size(); ++s) {
+                        volatility->setValue(scenarios[s].volatility);
+                        options[s]->setPricingEngine(engine);
+                        boost::chrono::steady_clock::time_point start =
+                            boost::chrono::steady_clock::now();
+                        Real error = options[s]->NPV() - references[s];
+                        elapsed += seconds(start);
+                        sumOfSquares += error*error;
+                        maxError = std::max(maxError, std::fabs(error));
+                    }
+                    Result result;
+                    result.tree = trees[t].name;
+                    result.steps = steps[n];
+                    result.rmsError =
+                        std::sqrt(sumOfSquares/scenarios.size());
+                    result.maxError = maxError;
+                    result.cost = elapsed/scenarios.size();
+                    results.push_back(result);
+
+                    std::cout << optionClass.name << ","
+                              << result.tree << ","
+                              << result.steps << ","
+                              << result.rmsError << ","
+                              << result.maxError << ","
+                              << result.cost*1.0e6 << std::endl;
+                }
+            }
+
+            // a result is on the frontier if no cheaper one is as accurate
+            std::sort(results.begin(), results.end(), cheaper);
+            std::cout << std::endl
+                      << "Pareto frontier for " << optionClass.name
+                      << std::endl;
+            std::cout << std::setw(36) << std::left << "tree"
+                      << std::setw(8) << "steps"
+                      << std::setw(14) << "rms error"
+                      << std::setw(14) << "max error"
+                      << "microseconds" << std::endl;
+            Real bestError = QL_MAX_REAL;
+            for (Size i=0; i<results.size(); ++i) {
+                if (results[i].rmsError < bestError) {
+                    bestError = results[i].rmsError;
+                    std::cout << std::setw(36) << std::left
+                              << results[i].tree
+                              << std::setw(8) << results[i].steps
+                              << std::setw(14) << results[i].rmsError
+                              << std::setw(14) << results[i].maxError
+                              << results[i].cost*1.0e6 << std::endl;
+                }
+            }
+            std::cout << std::endl;
+        }
+
+        return 0;
+
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "unknown error" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,318 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file treeimpliedvolatility.hpp
+    \brief Batched implied volatilities from binomial trees
+*/
+
+#ifndef tree_implied_volatility_hpp
+#define tree_implied_volatility_hpp
+
+#include <ql/instruments/vanillaoption.hpp>
+#include <ql/pricingengines/blackformula.hpp>
+#include <ql/processes/blackscholesprocess.hpp>
+#include <ql/quotes/simplequote.hpp>
+#include <ql/termstructures/yield/flatforward.hpp>
+#include <ql/termstructures/volatility/equityfx/blackconstantvol.hpp>
+#include <ql/time/calendars/nullcalendar.hpp>
+#include <ql/time/daycounters/actual365fixed.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <utility>
+#include <vector>
+
+namespace QuantLib {
+
+    //! Vanilla option pricer rolling back a tree in place
+    /*! The tree, binomial or trinomial, is walked directly, without
+        going through a lattice and a discretized asset, and with
+        descendants of node j assumed at j, j+1, ...; the option
+        values are kept in a single buffer which is overwritten at each
+        step and reused across calls, so that no allocation is made
+        once it has grown to the size of the largest tree.
+
+        The number of steps is the one of the tree, which for
+        LeisenReimer_2 and Joshi4_2 is made odd; with an odd number of
+        steps, the value is the same as that of BinomialVanillaEngine_2.
+    */
+    template <class T>
+    class BinomialVanillaRollback_2 {
+      public:
+        Real operator()(const boost::shared_ptr<StochasticProcess1D>& process,
+                        const StrikedTypePayoff& payoff,
+                        bool american, Rate riskFreeRate,
+                        Time maturity, Size timeSteps) {
+            T tree(process, maturity, timeSteps, payoff.strike());
+            Size steps = tree.columns()-1;
+            Real discount = std::exp(-riskFreeRate*maturity/steps);
+
+            values_.resize(tree.size(steps));
+            for (Size j=0; j<tree.size(steps); ++j)
+                values_[j] = payoff(tree.underlying(steps, j));
+
+            for (Size i=steps; i>0; --i) {
+                // nodes at step i-1 only use values at higher indices,
+                // which are still those of step i
+                for (Size j=0; j<tree.size(i-1); ++j) {
+                    Real value = 0.0;
+                    for (Size b=0; b<Size(T::branches); ++b)
+                        value += tree.probability(i-1, j, b) *
+                                 values_[tree.descendant(i-1, j, b)];
+                    value *= discount;
+                    if (american)
+                        value = std::max(value,
+                                         payoff(tree.underlying(i-1, j)));
+                    values_[j] = value;
+                }
+            }
+            // middle of the three nodes at t=0
+            return values_[1];
+        }
+      private:
+        std::vector<Real> values_;
+    };
+
+
+    //! Batched implied volatilities of vanilla options on binomial trees
+    /*! Each volatility is the one for which the option value on a tree
+        of type T matches the given price. Its search starts from the
+        Black-Scholes implied volatility of the price, which is exact
+        for European options in the limit of many steps and an upper
+        bound for American ones; the first step is a Newton step using
+        the Black-Scholes vega, and the following ones are secant steps
+        on the tree values, so that each iteration costs a single tree.
+
+        The market data are read from the process, whose volatility is
+        ignored, before the solves are distributed among threads; the
+        solves themselves only use objects local to their thread.
+        Options for which no volatility is found within the bounds and
+        the maximum number of iterations get Null<Volatility>().
+    */
+    template <class T>
+    class TreeImpliedVolatility_2 {
+      public:
+        typedef std::pair<boost::shared_ptr<VanillaOption>, Real> Request;
+        /*! \param accuracy  required accuracy on the volatility
+            \param threads   worker threads; 0 for one per core
+        */
+        TreeImpliedVolatility_2(Size timeSteps,
+                                Real accuracy = 1.0e-4,
+                                Size maxIterations = 100,
+                                Size threads = 0,
+                                Volatility minVol = 1.0e-7,
+                                Volatility maxVol = 4.0)
+        : timeSteps_(timeSteps), accuracy_(accuracy),
+          maxIterations_(maxIterations), threads_(threads),
+          minVol_(minVol), maxVol_(maxVol) {
+            QL_REQUIRE(timeSteps >= 2,
+                       "at least 2 time steps required, "
+                       << timeSteps << " provided");
+            QL_REQUIRE(accuracy > 0.0, "positive accuracy required");
+            QL_REQUIRE(minVol > 0.0 && minVol < maxVol,
+                       "invalid volatility range [" << minVol << ", "
+                       << maxVol << "]");
+            if (threads_ == 0)
+                threads_ = std::max<Size>(
+                               boost::thread::hardware_concurrency(), 1);
+        }
+        std::vector<Volatility> calculate(
+             const std::vector<Request>& requests,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                                                         process) const;
+      private:
+        struct Problem {
+            boost::shared_ptr<StrikedTypePayoff> payoff;
+            bool american;
+            Real spot, price;
+            Rate riskFreeRate, dividendYield;
+            Time maturity;
+        };
+        class Worker;
+        Volatility solve(const Problem& problem,
+                         BinomialVanillaRollback_2<T>& rollback) const;
+        Size timeSteps_;
+        Real accuracy_;
+        Size maxIterations_, threads_;
+        Volatility minVol_, maxVol_;
+    };
+
+
+    // template definitions
+
+    template <class T>
+    class TreeImpliedVolatility_2<T>::Worker {
+      public:
+        Worker(const TreeImpliedVolatility_2<T>& solver,
+               const std::vector<Problem>& problems,
+               std::vector<Volatility>& results,
+               boost::atomic<Size>& next)
+        : solver_(solver), problems_(problems), results_(results),
+          next_(next) {}
+        void operator()() const {
+            BinomialVanillaRollback_2<T> rollback;
+            for (;;) {
+                Size i = next_.fetch_add(1);
+                if (i >= problems_.size())
+                    return;
+                try {
+                    results_[i] = solver_.solve(problems_[i], rollback);
+                } catch (std::exception&) {
+                    results_[i] = Null<Volatility>();
+                }
+            }
+        }
+      private:
+        const TreeImpliedVolatility_2<T>& solver_;
+        const std::vector<Problem>& problems_;
+        std::vector<Volatility>& results_;
+        boost::atomic<Size>& next_;
+    };
+
+
+    template <class T>
+    std::vector<Volatility> TreeImpliedVolatility_2<T>::calculate(
+             const std::vector<Request>& requests,
+             const boost::shared_ptr<GeneralizedBlackScholesProcess>&
+                                                       process) const {
+        std::vector<Problem> problems(requests.size());
+        Real spot = process->x0();
+        for (Size i=0; i<requests.size(); ++i) {
+            const boost::shared_ptr<VanillaOption>& option =
+                requests[i].first;
+            Problem& p = problems[i];
+            p.payoff = boost::dynamic_pointer_cast<StrikedTypePayoff>(
+                                                         option->payoff());
+            QL_REQUIRE(p.payoff, "non-striked payoff given");
+            boost::shared_ptr<Exercise> exercise = option->exercise();
+            QL_REQUIRE(exercise->type() != Exercise::Bermudan,
+                       "Bermudan exercise not supported");
+            p.american = exercise->type() == Exercise::American;
+            p.spot = spot;
+            p.price = requests[i].second;
+            p.maturity = process->time(exercise->lastDate());
+            p.riskFreeRate = process->riskFreeRate()->zeroRate(
+                                     p.maturity, Continuous, NoFrequency);
+            p.dividendYield = process->dividendYield()->zeroRate(
+                                     p.maturity, Continuous, NoFrequency);
+        }
+
+        std::vector<Volatility> results(problems.size());
+        boost::atomic<Size> next(0);
+        Worker worker(*this, problems, results, next);
+        Size threads = std::min(threads_, problems.size());
+        boost::thread_group workers;
+        for (Size i=1; i<threads; ++i)
+            workers.create_thread(worker);
+        worker();
+        workers.join_all();
+        return results;
+    }
+
+
+    template <class T>
+    Volatility TreeImpliedVolatility_2<T>::solve(
+                              const Problem& problem,
+                              BinomialVanillaRollback_2<T>& rollback) const {
+        const Real discount =
+            std::exp(-problem.riskFreeRate*problem.maturity);
+        const Real forward = problem.spot *
+            std::exp((problem.riskFreeRate-problem.dividendYield) *
+                     problem.maturity);
+        const Real strike = problem.payoff->strike();
+        const Real sqrtT = std::sqrt(problem.maturity);
+
+        // local market, so that the solve doesn't share observables
+        Date today = Settings::instance().evaluationDate();
+        DayCounter dayCounter = Actual365Fixed();
+        boost::shared_ptr<SimpleQuote> volatility(new SimpleQuote(0.0));
+        boost::shared_ptr<StochasticProcess1D> process(
+            new GeneralizedBlackScholesProcess(
+                Handle<Quote>(boost::shared_ptr<Quote>(
+                                           new SimpleQuote(problem.spot))),
+                Handle<YieldTermStructure>(
+                    boost::shared_ptr<YieldTermStructure>(
+                        new FlatForward(today, problem.dividendYield,
+                                        dayCounter))),
+                Handle<YieldTermStructure>(
+                    boost::shared_ptr<YieldTermStructure>(
+                        new FlatForward(today, problem.riskFreeRate,
+                                        dayCounter))),
+                Handle<BlackVolTermStructure>(
+                    boost::shared_ptr<BlackVolTermStructure>(
+                        new BlackConstantVol(today, NullCalendar(),
+                                             Handle<Quote>(volatility),
+                                             dayCounter)))));
+
+        Volatility sigma0;
+        try {
+            sigma0 = blackFormulaImpliedStdDev(problem.payoff->optionType(),
+                                               strike, forward,
+                                               problem.price,
+                                               discount) / sqrtT;
+        } catch (std::exception&) {
+            // below the European intrinsic value, as for deep
+            // in-the-money American puts
+            sigma0 = 0.2;
+        }
+        sigma0 = std::min(std::max(sigma0, minVol_), maxVol_);
+
+        volatility->setValue(sigma0);
+        Real error0 = rollback(process, *problem.payoff, problem.american,
+                               problem.riskFreeRate, problem.maturity,
+                               timeSteps_) - problem.price;
+
+        Real vega = blackFormulaStdDevDerivative(strike, forward,
+                                                 sigma0*sqrtT,
+                                                 discount) * sqrtT;
+        Volatility sigma1 = vega > QL_EPSILON ?
+            sigma0 - error0/vega : sigma0 + 0.01;
+
+        for (Size k=0; k<maxIterations_; ++k) {
+            // keep within the bounds and within a factor of 2 from the
+            // last point, as the tree value is only piecewise smooth
+            sigma1 = std::min(std::max(sigma1, 0.5*sigma0), 2.0*sigma0);
+            sigma1 = std::min(std::max(sigma1, minVol_), maxVol_);
+            if (std::fabs(sigma1-sigma0) < accuracy_) {
+                // stuck at a bound: the price can't be matched
+                if (sigma1 == minVol_ || sigma1 == maxVol_)
+                    return Null<Volatility>();
+                return sigma1;
+            }
+
+            volatility->setValue(sigma1);
+            Real error1 = rollback(process, *problem.payoff,
+                                   problem.american, problem.riskFreeRate,
+                                   problem.maturity, timeSteps_)
+                - problem.price;
+            if (error1 == 0.0)
+                return sigma1;
+            if (error1 == error0)
+                return Null<Volatility>();
+
+            Volatility sigma2 =
+                sigma1 - error1*(sigma1-sigma0)/(error1-error0);
+            sigma0 = sigma1;
+            error0 = error1;
+            sigma1 = sigma2;
+        }
+        return Null<Volatility>();
+    }
+
+}
+
+
+#endif
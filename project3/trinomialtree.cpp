@@ -0,0 +1,65 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include "trinomialtree.hpp"
+#include <ql/stochasticprocess.hpp>
+
+namespace QuantLib {
+
+    Boyle_2::Boyle_2(const boost::shared_ptr<StochasticProcess1D>& process,
+                     Time end, Size steps, Real, Size widening)
+    : TrinomialTree_2<Boyle_2>(process, end, steps, widening) {
+
+        Real variance = process->variance(0.0, x0_, dt_);
+        dx_ = std::sqrt(2.0*variance);
+
+        // growth over half a step, and half-step jumps
+        Real a = std::exp(0.5*(driftPerStep_ + 0.5*variance));
+        Real up = std::exp(std::sqrt(0.5*variance));
+        Real down = 1.0/up;
+        pu_ = (a - down)/(up - down);
+        pu_ *= pu_;
+        pd_ = (up - a)/(up - down);
+        pd_ *= pd_;
+        pm_ = 1.0 - pu_ - pd_;
+
+        QL_REQUIRE(pu_>=0.0 && pd_>=0.0 && pm_>=0.0,
+                   "negative probability");
+    }
+
+
+    KamradRitchken_2::KamradRitchken_2(
+                        const boost::shared_ptr<StochasticProcess1D>& process,
+                        Time end, Size steps, Real, Size widening,
+                        Real stretch)
+    : TrinomialTree_2<KamradRitchken_2>(process, end, steps, widening) {
+
+        QL_REQUIRE(stretch >= 1.0,
+                   "stretch must be at least 1, " << stretch << " given");
+        Real stdDev = process->stdDeviation(0.0, x0_, dt_);
+        dx_ = stretch*stdDev;
+
+        Real lambda2 = stretch*stretch;
+        Real skew = driftPerStep_/(2.0*stretch*stdDev);
+        pu_ = 0.5/lambda2 + skew;
+        pd_ = 0.5/lambda2 - skew;
+        pm_ = 1.0 - 1.0/lambda2;
+
+        QL_REQUIRE(pu_>=0.0 && pd_>=0.0, "negative probability");
+    }
+
+}
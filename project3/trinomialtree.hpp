@@ -0,0 +1,114 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file trinomialtree.hpp
+    \brief Trinomial tree classes
+*/
+
+#ifndef trinomial_tree_hpp
+#define trinomial_tree_hpp
+
+#include <ql/methods/lattices/tree.hpp>
+#include <ql/stochasticprocess.hpp>
+
+namespace QuantLib {
+
+    //! Trinomial tree base class
+    /*! Like BinomialTree_2, the tree is widened by 2m nodes at each
+        step so that it has 2m+1 nodes at t=0, from the middle three of
+        which greeks are estimated; the nodes are evenly spaced in log
+        space around the spot and the drift is carried by the
+        probabilities, which are the same at every node.
+
+        \ingroup lattices
+    */
+    template <class T>
+    class TrinomialTree_2 : public Tree<T> {
+      public:
+        enum Branches { branches = 3 };
+        TrinomialTree_2(const boost::shared_ptr<StochasticProcess1D>& process,
+                        Time end,
+                        Size steps,
+                        Size widening = 1)
+        : Tree<T>(steps+1), widening_(widening) {
+            QL_REQUIRE(widening >= 1, "widening must be at least 1");
+            x0_ = process->x0();
+            dt_ = end/steps;
+            driftPerStep_ = process->drift(0.0, x0_) * dt_;
+        }
+        Size size(Size i) const {
+            return 2*i+2*widening_+1;
+        }
+        Size descendant(Size, Size index, Size branch) const {
+            return index + branch;
+        }
+        Real underlying(Size i, Size index) const {
+            BigInteger j = BigInteger(index) - BigInteger(i)
+                         - BigInteger(widening_);
+            return x0_*std::exp(j*dx_);
+        }
+        Real probability(Size, Size, Size branch) const {
+            return (branch == 2 ? pu_ : (branch == 1 ? pm_ : pd_));
+        }
+        Size widening() const { return widening_; }
+      protected:
+        Size widening_;
+        Real x0_, driftPerStep_;
+        Time dt_;
+        Real dx_, pu_, pm_, pd_;
+    };
+
+
+    //! %Boyle trinomial tree
+    /*! The jump is \f$ \sigma \sqrt{2 \Delta t} \f$ and the
+        probabilities match the first two moments of the underlying.
+
+        \ingroup lattices
+    */
+    class Boyle_2 : public TrinomialTree_2<Boyle_2> {
+      public:
+        Boyle_2(const boost::shared_ptr<StochasticProcess1D>&,
+                Time end,
+                Size steps,
+                Real strike,
+                Size widening = 1);
+    };
+
+
+    //! %Kamrad-Ritchken trinomial tree
+    /*! The jump is \f$ \lambda \sigma \sqrt{\Delta t} \f$ and the
+        probabilities match the first two moments of the log of the
+        underlying; the middle probability is \f$ 1 - 1/\lambda^2 \f$.
+        The default stretch \f$ \lambda = \sqrt{3/2} \f$ gives equal
+        weight to the three branches in the driftless case.
+
+        \ingroup lattices
+    */
+    class KamradRitchken_2 : public TrinomialTree_2<KamradRitchken_2> {
+      public:
+        KamradRitchken_2(const boost::shared_ptr<StochasticProcess1D>&,
+                         Time end,
+                         Size steps,
+                         Real strike,
+                         Size widening = 1,
+                         Real stretch = 1.224744871391589);
+    };
+
+}
+
+
+#endif
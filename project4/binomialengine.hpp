@@ -35,6 +35,7 @@
 #include <ql/processes/blackscholesprocess.hpp>
 #include <ql/termstructures/yield/flatforward.hpp>
 #include <ql/termstructures/volatility/equityfx/blackconstantvol.hpp>
+#include "../common/instrumentation.hpp"
 
 namespace QuantLib {
 
@@ -74,6 +75,9 @@ namespace QuantLib {
     template <class T>
     void BinomialVanillaEngine_2<T>::calculate() const {
 
+        IMT_TRACE_SCOPE("binomial.calculate");
+        IMT_TRACE_BEGIN(setupSpan, "binomial.setup");
+
         DayCounter rfdc  = process_->riskFreeRate()->dayCounter();
         DayCounter divdc = process_->dividendYield()->dayCounter();
         DayCounter voldc = process_->blackVolatility()->dayCounter();
@@ -111,7 +115,9 @@ namespace QuantLib {
                          new GeneralizedBlackScholesProcess(
                                       process_->stateVariable(),
                                       flatDividends, flatRiskFree, flatVol));
+        IMT_TRACE_END(setupSpan);
 
+        IMT_TRACE_BEGIN(treeSpan, "binomial.tree");
         TimeGrid grid(maturity, timeSteps_);
 
         boost::shared_ptr<T> tree(new T(bs, maturity, timeSteps_,
@@ -120,9 +126,15 @@ namespace QuantLib {
         boost::shared_ptr<BlackScholesLattice<T> > lattice(
             new BlackScholesLattice<T>(tree, r, maturity, timeSteps_));
 
+        IMT_TRACE_END(treeSpan);
+
+        IMT_TRACE_BEGIN(initializeSpan, "binomial.initialize");
         DiscretizedVanillaOption option(arguments_, *process_, grid);
 
         option.initialize(lattice, maturity);
+        IMT_TRACE_END(initializeSpan);
+        // nodes evaluated by the rollback: step i has i+1 of them
+        IMT_COUNT("binomial.nodes", timeSteps_*(timeSteps_+1)/2);
 
         // Partial derivatives calculated from various points in the
         // binomial tree 
@@ -130,7 +142,9 @@ namespace QuantLib {
 
         // Rollback to third-last step, and get underlying prices (s2) &
         // option values (p2) at this point
+        IMT_TRACE_BEGIN(rollback2Span, "binomial.rollback.grid2");
         option.rollback(grid[2]);
+        IMT_TRACE_END(rollback2Span);
         Array va2(option.values());
         QL_ENSURE(va2.size() == 3, "Expect 3 nodes in grid at second step");
         Real p2u = va2[2]; // up
@@ -147,7 +161,9 @@ namespace QuantLib {
 
         // Rollback to second-last step, and get option values (p1) at
         // this point
+        IMT_TRACE_BEGIN(rollback1Span, "binomial.rollback.grid1");
         option.rollback(grid[1]);
+        IMT_TRACE_END(rollback1Span);
         Array va(option.values());
         QL_ENSURE(va.size() == 2, "Expect 2 nodes in grid at first step");
         Real p1u = va[1];
@@ -158,7 +174,9 @@ namespace QuantLib {
         Real delta = (p1u - p1d) / (s1u - s1d);
 
         // Finally, rollback to t=0
+        IMT_TRACE_BEGIN(rollback0Span, "binomial.rollback.0");
         option.rollback(0.0);
+        IMT_TRACE_END(rollback0Span);
         Real p0 = option.presentValue();
 
         // Store results